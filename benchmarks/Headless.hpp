@@ -0,0 +1,91 @@
+/*
+HeadlessContext class - v1
+- OpenGL 3.3 core context created with EGL, without windows or surfaces (used by the benchmarks)
+
+The Mesa surfaceless platform is used if available (no X11 or Wayland server is needed, and it runs on llvmpipe without a GPU), otherwise the default display. The benchmarks render in their own framebuffer objects.
+
+N.B.) the OpenGL functions are loaded with glad after the creation of the context
+*/
+
+#pragma once
+
+#include <iostream>
+
+#include <glad/glad.h>
+
+// EGL without the X11 types (they clash with the names used by the other libraries)
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+///////////////////  HeadlessContext class ///////////////////////
+class HeadlessContext
+{
+public:
+    EGLDisplay display;
+    EGLContext context;
+
+    HeadlessContext()
+    {
+        this->display = EGL_NO_DISPLAY;
+        this->context = EGL_NO_CONTEXT;
+    }
+
+    //////////////////////////////////////////
+    // we create the context, we make it current, and we load the OpenGL functions
+    bool Create()
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            this->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (this->display == EGL_NO_DISPLAY)
+            this->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major, minor;
+        if (this->display == EGL_NO_DISPLAY || !eglInitialize(this->display, &major, &minor)) {
+            std::cerr << "ERROR: failed to initialise EGL" << std::endl;
+            return false;
+        }
+
+        // no surface types: the default (window) would exclude the configurations of the surfaceless platform
+        const EGLint configAttribs[] = { EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config;
+        EGLint count;
+        if (!eglChooseConfig(this->display, configAttribs, &config, 1, &count) || count == 0 || !eglBindAPI(EGL_OPENGL_API)) {
+            std::cerr << "ERROR: no EGL configuration for OpenGL" << std::endl;
+            return false;
+        }
+
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        this->context = eglCreateContext(this->display, config, EGL_NO_CONTEXT, contextAttribs);
+        if (this->context == EGL_NO_CONTEXT || !eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->context)) {
+            std::cerr << "ERROR: failed to create the OpenGL 3.3 context" << std::endl;
+            return false;
+        }
+
+        if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+            std::cerr << "ERROR: failed to initialise GLAD" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    //////////////////////////////////////////
+    // we release the context and the display
+    void Destroy()
+    {
+        if (this->display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (this->context != EGL_NO_CONTEXT)
+            eglDestroyContext(this->display, this->context);
+        eglTerminate(this->display);
+        this->display = EGL_NO_DISPLAY;
+        this->context = EGL_NO_CONTEXT;
+    }
+};
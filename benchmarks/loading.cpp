@@ -0,0 +1,298 @@
+/*
+    g++ benchmarks/loading.cpp src/glad.c -o loading_bench -O2 -I ./includes -lEGL -lGL -ldl -lassimp
+
+Asset loading benchmark: it loads the assets of the application in an offscreen OpenGL context (see HeadlessContext class), and it measures the time of each stage:
+- models (Model class): Assimp import, conversion of the meshes (processMesh), material textures (loadMaterialTextures), creation of the OpenGL buffers
+- textures (TextureFromFile): decode of the image file, upload to OpenGL (with mipmaps)
+- skybox (same code of loadCubeMap in the application): decode and upload of each face
+- shaders (Shader class): compilation and linking of the GLSL sources, and loading of the cached program binary
+
+Each asset is loaded with cold file cache (the pages of the asset files are dropped from the page cache with posix_fadvise before the load) and with warm file cache (the same files, just read). The medians over the runs, and the throughput in MB/s (size of the files read / total time), are written in JSON to the standard output:
+
+    LIBGL_ALWAYS_SOFTWARE=1 ./loading_bench [--runs N] > loading.json
+
+N.B. 1) the timings of the stages of the models are collected by the Model class (see LoadStats structure): MODEL_LOAD_STATS is defined before its inclusion, to compile the timing code
+N.B. 2) the shaders are compiled with the cache disabled, and then loaded from the cache written by the first compilation (they are not affected by the file cache)
+N.B. 3) posix_fadvise cannot drop pages which are dirty or mapped by another process: to have really cold caches, the assets must not be open in other applications. As an alternative, run the benchmark as root after "sync; echo 1 > /proc/sys/vm/drop_caches"
+*/
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <utils/Shader.hpp>
+// the Model class collects the timings of the loading stages (see N.B. 1)
+#define MODEL_LOAD_STATS
+#include <utils/Model.hpp>
+
+#include "Headless.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// folders of the assets (their files are dropped from the page cache before the cold loads)
+const char* assetFolders[] = { "models/car", "models/terrain", "textures/clouds1" };
+const unsigned int ASSET_FOLDERS = 3;
+
+// assets of the application
+const char* modelPaths[] = { "models/car/car.obj", "models/car/tyref.obj", "models/car/tyreb.obj", "models/terrain/grass.obj", "models/terrain/asphalt.obj" };
+const unsigned int MODELS = 5;
+// textures loaded directly (path relative to the folder, folder)
+const char* texturePaths[][2] = { { "Blue.png", "models/car" }, { "Spec.png", "models/car" }, { "grass.png", "models/terrain" }, { "grass_norm.png", "models/terrain" }, { "asphalt.png", "models/terrain" } };
+const unsigned int TEXTURES = 5;
+const char* cubemapFaces[] = {
+    "textures/clouds1/clouds1_east.bmp", "textures/clouds1/clouds1_west.bmp", "textures/clouds1/clouds1_up.bmp",
+    "textures/clouds1/clouds1_down.bmp", "textures/clouds1/clouds1_north.bmp", "textures/clouds1/clouds1_south.bmp"
+};
+const unsigned int FACES = 6;
+const char* shaderPaths[][2] = { { "shaders/car.vert", "shaders/car.frag" }, { "shaders/terrain.vert", "shaders/terrain.frag" }, { "shaders/skybox.vert", "shaders/skybox.frag" } };
+const unsigned int SHADERS = 3;
+
+enum caches { CACHE_COLD, CACHE_WARM, CACHES };
+const char* cacheNames[CACHES] = { "cold", "warm" };
+
+// samples of the stage timings of each asset, for cold and warm caches
+vector<LoadStats> modelSamples[MODELS][CACHES];
+vector<LoadStats> textureSamples[TEXTURES][CACHES];
+vector<LoadStats> faceSamples[FACES][CACHES];
+// samples of the creation time of each program (s), compiled and from the cache
+vector<double> compileSamples[SHADERS], binarySamples[SHADERS];
+bool shadersCached[SHADERS];
+
+//////////////////////////////////////////
+// size of a file in bytes (0 if it does not exist)
+size_t fileSize(const string& path)
+{
+    struct stat info;
+    return (stat(path.c_str(), &info) == 0) ? (size_t)info.st_size : 0;
+}
+
+// we drop the pages of all the files of the asset folders from the page cache
+void dropCaches()
+{
+    for (unsigned int f = 0; f < ASSET_FOLDERS; f++) {
+        DIR* dir = opendir(assetFolders[f]);
+        if (!dir)
+            continue;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            string path = string(assetFolders[f]) + "/" + entry->d_name;
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                continue;
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+        closedir(dir);
+    }
+}
+
+//////////////////////////////////////////
+// loading of a model: stages timed by the Model class, textures and buffers released at the end
+LoadStats loadModel(const char* path)
+{
+    LoadStats stats = LoadStats();
+    loadStats = &stats;
+    {
+        Model model((char*) path);
+        for (unsigned int i = 0; i < model.textures_loaded.size(); i++) {
+            GLuint id = model.textures_loaded[i].id;
+            glDeleteTextures(1, &id);
+        }
+    }
+    loadStats = NULL;
+    glFinish();
+    return stats;
+}
+
+// loading of a texture with TextureFromFile
+LoadStats loadTexture(const char* path, const char* directory)
+{
+    LoadStats stats = LoadStats();
+    loadStats = &stats;
+    GLuint id = TextureFromFile(path, directory);
+    loadStats = NULL;
+    glFinish();
+    glDeleteTextures(1, &id);
+    return stats;
+}
+
+// loading of a face of the cube map (same code of loadCubeMap in the application)
+LoadStats loadFace(GLuint cubemap, unsigned int face)
+{
+    LoadStats stats = LoadStats();
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+    int width, height, channels;
+    double start = loadClock();
+    unsigned char* data = stbi_load(cubemapFaces[face], &width, &height, &channels, 0);
+    double decoded = loadClock();
+    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    glFinish();
+    stats.textureDecode = decoded - start;
+    stats.textureUpload = loadClock() - decoded;
+    stats.textureFileBytes = fileSize(cubemapFaces[face]);
+    stats.texturePixelBytes = data ? (size_t)width * height * channels : 0;
+    stbi_image_free(data);
+    return stats;
+}
+
+// creation of a program with the Shader class (from the cache, if enabled and available)
+double loadShader(unsigned int index, bool cache, bool* fromCache = NULL)
+{
+    const char* folder = shaderCacheFolder;
+    if (!cache)
+        shaderCacheFolder = NULL;
+    double start = loadClock();
+    Shader shader(shaderPaths[index][0], shaderPaths[index][1]);
+    glFinish();
+    double time = loadClock() - start;
+    shaderCacheFolder = folder;
+    if (fromCache)
+        *fromCache = shader.FromCache;
+    shader.Delete();
+    return time;
+}
+
+//////////////////////////////////////////
+// median of the samples
+double median(vector<double> values)
+{
+    if (values.empty())
+        return 0.0;
+    sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// median of a field of the samples
+double median(const vector<LoadStats>& samples, double LoadStats::*field)
+{
+    if (samples.empty())
+        return 0.0;
+    vector<double> values(samples.size());
+    for (unsigned int i = 0; i < samples.size(); i++)
+        values[i] = samples[i].*field;
+    sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// JSON object with the median timings (ms) of the stages, and the throughput in MB/s
+void printStages(const vector<LoadStats>& samples, size_t bytes, bool model)
+{
+    double decode = median(samples, &LoadStats::textureDecode);
+    double upload = median(samples, &LoadStats::textureUpload);
+    double total = decode + upload;
+    cout << "{ ";
+    if (model) {
+        double import = median(samples, &LoadStats::import);
+        double convert = median(samples, &LoadStats::convert);
+        double textures = median(samples, &LoadStats::textures);
+        double buffers = median(samples, &LoadStats::upload);
+        total = import + convert + textures + buffers;
+        cout << "\"import_ms\": " << 1000.0 * import << ", \"convert_ms\": " << 1000.0 * convert << ", \"textures_ms\": " << 1000.0 * textures << ", \"upload_ms\": " << 1000.0 * buffers << ", ";
+    }
+    cout << "\"texture_decode_ms\": " << 1000.0 * decode << ", \"texture_upload_ms\": " << 1000.0 * upload << ", \"total_ms\": " << 1000.0 * total
+        << ", \"bytes\": " << bytes << ", \"mb_per_s\": " << (total > 0.0 ? bytes / total / 1e6 : 0.0) << " }";
+}
+
+int main(int argc, char** argv) {
+    unsigned int runs = 5;
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = atoi(argv[++i]);
+
+    HeadlessContext context;
+    if (!context.Create())
+        return EXIT_FAILURE;
+
+    GLuint cubemap;
+    glGenTextures(1, &cubemap);
+
+    for (unsigned int run = 0; run < runs; run++) {
+        for (int cache = CACHE_COLD; cache < CACHES; cache++) {
+            // cold: the files are dropped before each asset; warm: they have been just read by the cold load
+            for (unsigned int i = 0; i < MODELS; i++) {
+                if (cache == CACHE_COLD)
+                    dropCaches();
+                modelSamples[i][cache].push_back(loadModel(modelPaths[i]));
+            }
+            for (unsigned int i = 0; i < TEXTURES; i++) {
+                if (cache == CACHE_COLD)
+                    dropCaches();
+                textureSamples[i][cache].push_back(loadTexture(texturePaths[i][0], texturePaths[i][1]));
+            }
+            for (unsigned int i = 0; i < FACES; i++) {
+                if (cache == CACHE_COLD)
+                    dropCaches();
+                faceSamples[i][cache].push_back(loadFace(cubemap, i));
+            }
+        }
+        for (unsigned int i = 0; i < SHADERS; i++) {
+            compileSamples[i].push_back(loadShader(i, false));
+            // the first run writes the cache, if it is not there yet
+            if (run == 0)
+                loadShader(i, true);
+            binarySamples[i].push_back(loadShader(i, true, &shadersCached[i]));
+        }
+    }
+
+    // results
+    cout << "{" << endl;
+    cout << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\", \"runs\": " << runs << "," << endl;
+
+    cout << "  \"models\": [" << endl;
+    for (unsigned int i = 0; i < MODELS; i++) {
+        // bytes read: the model file and its textures (the material file is small, and it is not counted)
+        size_t bytes = fileSize(modelPaths[i]) + (modelSamples[i][CACHE_COLD].empty() ? 0 : modelSamples[i][CACHE_COLD][0].textureFileBytes);
+        cout << "    { \"path\": \"" << modelPaths[i] << "\"";
+        for (int cache = CACHE_COLD; cache < CACHES; cache++) {
+            cout << ", \"" << cacheNames[cache] << "\": ";
+            printStages(modelSamples[i][cache], bytes, true);
+        }
+        cout << " }" << (i + 1 < MODELS ? "," : "") << endl;
+    }
+    cout << "  ]," << endl;
+
+    cout << "  \"textures\": [" << endl;
+    for (unsigned int i = 0; i < TEXTURES; i++) {
+        string path = string(texturePaths[i][1]) + "/" + texturePaths[i][0];
+        cout << "    { \"path\": \"" << path << "\"";
+        for (int cache = CACHE_COLD; cache < CACHES; cache++) {
+            cout << ", \"" << cacheNames[cache] << "\": ";
+            printStages(textureSamples[i][cache], fileSize(path), false);
+        }
+        cout << " }" << (i + 1 < TEXTURES ? "," : "") << endl;
+    }
+    cout << "  ]," << endl;
+
+    cout << "  \"cubemap\": [" << endl;
+    for (unsigned int i = 0; i < FACES; i++) {
+        cout << "    { \"path\": \"" << cubemapFaces[i] << "\"";
+        for (int cache = CACHE_COLD; cache < CACHES; cache++) {
+            cout << ", \"" << cacheNames[cache] << "\": ";
+            printStages(faceSamples[i][cache], fileSize(cubemapFaces[i]), false);
+        }
+        cout << " }" << (i + 1 < FACES ? "," : "") << endl;
+    }
+    cout << "  ]," << endl;
+
+    cout << "  \"shaders\": [" << endl;
+    for (unsigned int i = 0; i < SHADERS; i++) {
+        cout << "    { \"path\": \"" << shaderPaths[i][0] << "\", \"compile_ms\": " << 1000.0 * median(compileSamples[i])
+            << ", \"cached_ms\": " << 1000.0 * median(binarySamples[i]) << ", \"from_cache\": " << (shadersCached[i] ? "true" : "false") << " }" << (i + 1 < SHADERS ? "," : "") << endl;
+    }
+    cout << "  ]" << endl;
+    cout << "}" << endl;
+
+    glDeleteTextures(1, &cubemap);
+    GeometryArena::Static().Delete();
+    context.Destroy();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,347 @@
+/*
+    g++ benchmarks/physics.cpp -o physics_bench -O2 -pthread -I ./includes -I ./includes/bullet/ ./includes/bullet/BulletDynamics/libBulletDynamics.a ./includes/bullet/BulletCollision/libBulletCollision.a ./includes/bullet/LinearMath/libLinearMath.a -lbenchmark
+
+Physics microbenchmarks (Google Benchmark), CPU only: no window or OpenGL context is created.
+
+- Physics construction and teardown
+- createRigidBody throughput
+- one stepSimulation tick with 1, 10, 100, 1000 vehicles, built and updated like in the application (controls, drivetrain, brakes, aerodynamics at each tick)
+- the same tick with a single controlled vehicle and all the other ones parked (asleep)
+- update of the constraint limits of the suspensions (steering and handbrake)
+- Physics::Clear with 1, 10, 100, 1000 vehicles
+- successive scenarios in the same simulation (Physics::Reset, then the scene is built again) with 1, 10, 100, 1000 vehicles
+- respawn of a vehicle in place
+- systems of 10, 100, 1000 vehicles at a tick (controls, drivetrain, brakes, aerodynamics): methods of each Vehicle, and batch update of the VehicleStore
+- one tick of a driving vehicle at 0, 1, 10, 100 km from the origin, with the error of the suspensions (drift of the wheels along the locked axes of the constraints): compile with and without -DBT_USE_DOUBLE_PRECISION (and the corresponding Bullet build) to compare cost and precision
+- one step of independent regions (see RegionExecutor class) with 25 vehicles each, on 1, 2, 4, 8 threads
+
+N.B.) for the parallel regions, Bullet and the benchmark must be compiled with -DBT_NO_PROFILE, and the benchmark with -DREGIONS_PARALLEL, otherwise all the regions run on the calling thread (see Regions.hpp, and tests/regions.cpp for the check of the parallel step under ThreadSanitizer)
+
+The results are written in JSON, to be compared between commits:
+
+    ./physics_bench --benchmark_format=json > physics.json
+    ./physics_bench --benchmark_out=physics.json --benchmark_out_format=json
+*/
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <utils/Physics.hpp>
+#include <utils/Vehicle.hpp>
+#include <utils/Regions.hpp>
+#include <utils/VehicleStore.hpp>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace std;
+
+// parameters of the rig of the application (see main() in src/App.cpp)
+const float car_mass = 1250.0f;
+const float tyre_mass_1 = 15.0f;
+const float tyre_mass_2 = 20.0f;
+const float tyre_friction = 2.25f;
+const float tyre_stiffness = 120000.0f;
+const float tyre_damping = 0.0000200f;
+const float lowLim = 0.0f;
+const float upLim = 0.1f;
+
+// distance between the vehicles in the grid
+const float spacing = 8.0f;
+
+//////////////////////////////////////////
+// the systems of the vehicles, updated at each physics tick like in the application
+void physicsTick(btDynamicsWorld* world, btScalar timeStep)
+{
+    vector<Vehicle*>& vehicles = *(vector<Vehicle*>*)world->getWorldUserInfo();
+    for (unsigned int i = 0; i < vehicles.size(); i++) {
+        vehicles[i]->ApplyControls(timeStep);
+        vehicles[i]->UpdateDrivetrain(timeStep);
+        vehicles[i]->UpdateAerodynamics(timeStep);
+    }
+}
+
+//////////////////////////////////////////
+// a flat ground, and n vehicles in a square grid on it
+void buildScene(Physics& simulation, vector<Vehicle*>& vehicles, int n)
+{
+    int side = (int)glm::ceil(glm::sqrt((float)n));
+    float size = side * spacing + 100.0f;
+    simulation.createRigidBody(BOX, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(size, 1.0f, size), glm::vec3(0.0f), 0.0f, 1.0f, 0.0f, COLL_TERRAIN, COLL_EVERYTHING);
+
+    for (int i = 0; i < n; i++) {
+        glm::vec3 spawn = glm::vec3((i % side - side / 2) * spacing, 0.0f, (i / side - side / 2) * spacing);
+        vehicles.push_back(new Vehicle(simulation, spawn, car_mass, tyre_mass_1, tyre_mass_2, tyre_friction, tyre_stiffness, tyre_damping, lowLim, upLim));
+    }
+    simulation.dynamicsWorld->setInternalTickCallback(physicsTick, &vehicles, true);
+}
+
+// we delete the vehicles (they are removed from the simulation), and the simulation (bodies, constraints and shapes)
+void clearScene(Physics& simulation, vector<Vehicle*>& vehicles)
+{
+    for (unsigned int i = 0; i < vehicles.size(); i++)
+        delete vehicles[i];
+    vehicles.clear();
+    simulation.Clear();
+}
+
+//////////////////////////////////////////
+// construction and teardown of an empty simulation
+static void BM_PhysicsSetup(benchmark::State& state)
+{
+    for (auto _ : state) {
+        Physics simulation;
+        benchmark::DoNotOptimize(simulation.dynamicsWorld);
+        simulation.Clear();
+    }
+}
+BENCHMARK(BM_PhysicsSetup);
+
+// creation of rigid bodies (a box, like the chassis) in a simulation with range(0) bodies
+static void BM_CreateRigidBody(benchmark::State& state)
+{
+    for (auto _ : state) {
+        state.PauseTiming();
+        Physics simulation;
+        state.ResumeTiming();
+        for (int i = 0; i < state.range(0); i++)
+            benchmark::DoNotOptimize(simulation.createRigidBody(BOX, glm::vec3(i * 3.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.6f, 3.0f), glm::vec3(0.0f), car_mass, 1.75f, 0.2f, COLL_CHASSIS, COLL_EVERYTHING));
+        state.PauseTiming();
+        simulation.Clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CreateRigidBody)->Arg(1)->Arg(100)->Arg(1000);
+
+// one tick of the simulation with range(0) vehicles (resting on the ground, after they settled)
+static void BM_StepSimulation(benchmark::State& state)
+{
+    Physics simulation;
+    vector<Vehicle*> vehicles;
+    buildScene(simulation, vehicles, state.range(0));
+    // all the vehicles are awake, like the car of the player
+    for (unsigned int i = 0; i < vehicles.size(); i++)
+        vehicles[i]->SetControlled(true);
+    for (int i = 0; i < 60; i++)
+        simulation.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1);
+
+    for (auto _ : state)
+        simulation.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+
+    clearScene(simulation, vehicles);
+}
+BENCHMARK(BM_StepSimulation)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// one tick with range(0) vehicles: the first one is controlled, the other ones are parked, and they fall asleep after the deactivation time
+static void BM_StepParked(benchmark::State& state)
+{
+    Physics simulation;
+    vector<Vehicle*> vehicles;
+    buildScene(simulation, vehicles, state.range(0));
+    vehicles[0]->SetControlled(true);
+    for (int i = 0; i < 180; i++)
+        simulation.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1);
+
+    for (auto _ : state)
+        simulation.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+
+    int sleeping = 0;
+    for (unsigned int i = 0; i < vehicles.size(); i++)
+        sleeping += vehicles[i]->Sleeping();
+    state.counters["sleeping"] = sleeping;
+
+    clearScene(simulation, vehicles);
+}
+BENCHMARK(BM_StepParked)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// update of the angular limits of the 4 suspensions of a vehicle (steering and handbrake), as done at each tick
+static void BM_ConstraintLimits(benchmark::State& state)
+{
+    Physics simulation;
+    vector<Vehicle*> vehicles;
+    buildScene(simulation, vehicles, 1);
+    Vehicle* vehicle = vehicles[0];
+
+    bool handbrake = false;
+    for (auto _ : state) {
+        vehicle->steer = handbrake ? -1.0f : 1.0f;
+        vehicle->handbrake = handbrake;
+        vehicle->ApplyControls(1.0f / 60.0f);
+        handbrake = !handbrake;
+    }
+    state.SetItemsProcessed(state.iterations() * WHEELS);
+
+    clearScene(simulation, vehicles);
+}
+BENCHMARK(BM_ConstraintLimits);
+
+// deletion of a simulation with range(0) vehicles
+static void BM_PhysicsClear(benchmark::State& state)
+{
+    for (auto _ : state) {
+        state.PauseTiming();
+        Physics simulation;
+        vector<Vehicle*> vehicles;
+        buildScene(simulation, vehicles, state.range(0));
+        state.ResumeTiming();
+        clearScene(simulation, vehicles);
+    }
+}
+BENCHMARK(BM_PhysicsClear)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// a new scenario in the same simulation with range(0) vehicles: the world is reset, and the scene is built again (the pools are reused)
+static void BM_PhysicsReset(benchmark::State& state)
+{
+    Physics simulation;
+    vector<Vehicle*> vehicles;
+    buildScene(simulation, vehicles, state.range(0));
+
+    for (auto _ : state) {
+        for (unsigned int i = 0; i < vehicles.size(); i++)
+            delete vehicles[i];
+        vehicles.clear();
+        simulation.Reset();
+        buildScene(simulation, vehicles, state.range(0));
+    }
+
+    clearScene(simulation, vehicles);
+}
+BENCHMARK(BM_PhysicsReset)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// respawn of a moving vehicle in place
+static void BM_Respawn(benchmark::State& state)
+{
+    Physics simulation;
+    vector<Vehicle*> vehicles;
+    buildScene(simulation, vehicles, 1);
+    Vehicle* vehicle = vehicles[0];
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        vehicle->throttle = 1.0f;
+        for (int i = 0; i < 10; i++)
+            simulation.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1);
+        state.ResumeTiming();
+        vehicle->Respawn(glm::vec3(0.0f));
+    }
+
+    clearScene(simulation, vehicles);
+}
+BENCHMARK(BM_Respawn);
+
+// systems of range(0) driving vehicles at a tick, updated one vehicle at a time (methods of the Vehicle class)
+static void BM_VehicleSystems(benchmark::State& state)
+{
+    Physics simulation;
+    vector<Vehicle*> vehicles;
+    buildScene(simulation, vehicles, state.range(0));
+    for (unsigned int i = 0; i < vehicles.size(); i++) {
+        vehicles[i]->SetControlled(true);
+        vehicles[i]->throttle = 1.0f;
+        vehicles[i]->steer = (i % 2) ? 1.0f : -1.0f;
+    }
+
+    for (auto _ : state)
+        for (unsigned int i = 0; i < vehicles.size(); i++) {
+            vehicles[i]->ApplyControls(1.0f / 60.0f);
+            vehicles[i]->UpdateDrivetrain(1.0f / 60.0f);
+            vehicles[i]->UpdateAerodynamics(1.0f / 60.0f);
+        }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+
+    clearScene(simulation, vehicles);
+}
+BENCHMARK(BM_VehicleSystems)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// the same systems, updated in a batch by the VehicleStore class
+static void BM_VehicleStore(benchmark::State& state)
+{
+    Physics simulation;
+    vector<Vehicle*> vehicles;
+    buildScene(simulation, vehicles, state.range(0));
+    VehicleStore store;
+    for (unsigned int i = 0; i < vehicles.size(); i++) {
+        vehicles[i]->SetControlled(true);
+        GLuint index = store.Add(vehicles[i]);
+        store.throttle[index] = 1.0f;
+        store.steer[index] = (i % 2) ? 1.0f : -1.0f;
+    }
+
+    for (auto _ : state)
+        store.Update(1.0f / 60.0f);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+
+    clearScene(simulation, vehicles);
+}
+BENCHMARK(BM_VehicleStore)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// one tick of a vehicle driving in circles at range(0) meters from the origin, on a ground box around it
+static void BM_StepFarFromOrigin(benchmark::State& state)
+{
+    Physics simulation;
+    vector<Vehicle*> vehicles;
+    glm::vec3 center = glm::vec3((float)state.range(0), 0.0f, (float)state.range(0));
+    simulation.createRigidBody(BOX, center + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(200.0f, 1.0f, 200.0f), glm::vec3(0.0f), 0.0f, 1.0f, 0.0f, COLL_TERRAIN, COLL_EVERYTHING);
+    Vehicle* vehicle = new Vehicle(simulation, center, car_mass, tyre_mass_1, tyre_mass_2, tyre_friction, tyre_stiffness, tyre_damping, lowLim, upLim);
+    vehicles.push_back(vehicle);
+    vehicle->SetControlled(true);
+    simulation.dynamicsWorld->setInternalTickCallback(physicsTick, &vehicles, true);
+    vehicle->throttle = 0.5f;
+    vehicle->steer = 1.0f;
+    for (int i = 0; i < 120; i++)
+        simulation.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1);
+
+    double error = 0.0;
+    long samples = 0;
+    for (auto _ : state) {
+        simulation.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1);
+        // position of the wheels in the frame of the chassis, compared with the suspension points (x and z are locked by the constraints)
+        state.PauseTiming();
+        btTransform inverse = vehicle->chassis->getWorldTransform().inverse();
+        for (GLuint w = 0; w < WHEELS; w++) {
+            btVector3 local = inverse * vehicle->wheels[w]->getWorldTransform().getOrigin();
+            btVector3 anchor = vehicle->suspensions[w]->getFrameOffsetA().getOrigin();
+            error += btFabs(local.x() - anchor.x()) + btFabs(local.z() - anchor.z());
+            samples++;
+        }
+        state.ResumeTiming();
+    }
+    state.counters["scalar_bytes"] = sizeof(btScalar);
+    state.counters["suspension_error_mm"] = 1000.0 * error / glm::max(samples, 1L);
+
+    clearScene(simulation, vehicles);
+}
+BENCHMARK(BM_StepFarFromOrigin)->Arg(0)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// one step of range(0) regions with 25 awake vehicles each, on range(1) threads (the calling thread included)
+static void BM_RegionsStep(benchmark::State& state)
+{
+    RegionExecutor executor(state.range(1) - 1);
+    for (int r = 0; r < state.range(0); r++) {
+        Region* region = executor.AddRegion();
+        region->simulation.createRigidBody(BOX, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(100.0f, 1.0f, 100.0f), glm::vec3(0.0f), 0.0f, 1.0f, 0.0f, COLL_TERRAIN, COLL_EVERYTHING);
+        for (int i = 0; i < 25; i++) {
+            glm::vec3 spawn = glm::vec3((i % 5 - 2) * spacing, 0.0f, (i / 5 - 2) * spacing);
+            region->AddVehicle(spawn, car_mass, tyre_mass_1, tyre_mass_2, tyre_friction, tyre_stiffness, tyre_damping, lowLim, upLim)->SetControlled(true);
+        }
+    }
+    for (int i = 0; i < 60; i++)
+        executor.Step(1.0f / 60.0f);
+
+    double slowest = 0.0;
+    for (auto _ : state) {
+        executor.Step(1.0f / 60.0f);
+        slowest += executor.slowestRegion;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 25);
+    state.counters["threads"] = executor.Threads();
+    // average of the slowest region: the best time of a step with enough threads
+    state.counters["slowest_region_us"] = 1e6 * slowest / state.iterations();
+}
+BENCHMARK(BM_RegionsStep)->ArgsProduct({ { 4, 16 }, { 1, 2, 4, 8 } })->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
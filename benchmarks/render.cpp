@@ -0,0 +1,350 @@
+/*
+    g++ benchmarks/render.cpp src/glad.c -o render_bench -O2 -I ./includes -lEGL -lGL -ldl -lassimp
+
+Headless rendering benchmark: an OpenGL 3.3 core context is created with EGL without any window (see HeadlessContext class), and the frames are rendered in a framebuffer object, so it runs also without a GPU, on Mesa llvmpipe:
+
+    LIBGL_ALWAYS_SOFTWARE=1 ./render_bench [--frames N] [--track path] > render.json
+
+The scene is the same of the application (track tiles, car with its wheels, skybox), with the car in the spawn position of the track. The camera flies along a scripted path, which depends only on the frame number: in the first half it orbits the car (like the follow camera of the application), in the second half it orbits the whole track from above.
+For each pass (terrain, car, skybox) we measure:
+- the CPU submit time: from the first to the last GL call of the pass
+- the total time: submit time + glFinish, so it includes the execution of the pass by the driver
+Frames per second are computed from the total time of the frames. Median and mean of each measure are written in JSON to the standard output.
+
+N.B. 1) the first warmup frames are not measured (shader compilation and uploads in the driver)
+N.B. 2) glFinish after each pass serializes CPU and GPU: the numbers are meant to compare two versions of the code on the same machine, not to predict the frame rate of the application
+*/
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <utils/Shader.hpp>
+#include <utils/Camera.hpp>
+#include <utils/Model.hpp>
+#include <utils/Frustum.hpp>
+#include <utils/Track.hpp>
+
+#include "Headless.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// same size of the window of the application
+const unsigned int SCR_WIDTH    = 960;
+const unsigned int SCR_HEIGHT   = 540;
+
+const unsigned int WARMUP_FRAMES = 30;
+
+// passes of a frame
+enum passes { PASS_TERRAIN, PASS_CAR, PASS_SKYBOX, PASSES };
+const char* passNames[PASSES] = { "terrain", "car", "skybox" };
+
+// timings of the measured frames (ms)
+vector<double> submitTimes[PASSES];
+vector<double> totalTimes[PASSES];
+vector<double> frameTimes;
+
+typedef chrono::high_resolution_clock Clock;
+
+unsigned int loadCubeMap();
+void printStats(const char* name, vector<double>& times, bool last);
+
+//////////////////////////////////////////
+// it measures a pass: CPU submit time, and time until the pass is completed
+template <typename F>
+void timePass(int pass, bool measure, F draw)
+{
+    Clock::time_point start = Clock::now();
+    draw();
+    Clock::time_point submitted = Clock::now();
+    glFinish();
+    Clock::time_point finished = Clock::now();
+    if (measure) {
+        submitTimes[pass].push_back(chrono::duration<double, milli>(submitted - start).count());
+        totalTimes[pass].push_back(chrono::duration<double, milli>(finished - start).count());
+    }
+}
+
+int main(int argc, char** argv) {
+    unsigned int frames = 600;
+    const char* trackPath = "tracks/oval.txt";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            int count = atoi(argv[++i]);
+            if (count < 1) {
+                std::cerr << "ERROR: --frames must be at least 1" << std::endl;
+                return EXIT_FAILURE;
+            }
+            frames = count;
+        }
+        else if (strcmp(argv[i], "--track") == 0 && i + 1 < argc)
+            trackPath = argv[++i];
+    }
+
+    HeadlessContext context;
+    if (!context.Create())
+        return EXIT_FAILURE;
+
+    // offscreen framebuffer, with the size of the window of the application
+    GLuint fbo, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR: offscreen framebuffer is not complete" << std::endl;
+        return EXIT_FAILURE;
+    }
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    // Scene (same assets of the application)
+    glm::vec3 lightPos(0.0, 2.0, -1.0);
+
+    Shader mShader("shaders/car.vert", "shaders/car.frag");
+    Model* mModel = new Model((char*) "models/car/car.obj");
+    Model* t1Model = new Model((char*) "models/car/tyref.obj");
+    Model* t2Model = new Model((char*) "models/car/tyreb.obj");
+
+    Shader tShader("shaders/terrain.vert", "shaders/terrain.frag");
+    Model* tModel0 = new Model((char*) "models/terrain/grass.obj");
+    Model* tModel1 = new Model((char*) "models/terrain/asphalt.obj");
+
+    Shader sShader("shaders/skybox.vert", "shaders/skybox.frag");
+    vector<Vertex> skyboxMeshVertices(36);
+    vector<GLuint> skyboxMeshIndices(36);
+    // the 6 faces of the cube, 2 triangles each (as in the application)
+    float skyboxVertices[] = {
+        -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f,
+         1.0f, -1.0f, -1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,
+        -1.0f,  1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f,
+        -1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f
+    };
+    for (unsigned int i = 0; i < 36; i++) {
+        skyboxMeshVertices[i] = Vertex();
+        skyboxMeshVertices[i].Position = glm::vec3(skyboxVertices[3*i], skyboxVertices[3*i+1], skyboxVertices[3*i+2]);
+        skyboxMeshIndices[i] = i;
+    }
+    Mesh skyboxMesh(std::move(skyboxMeshVertices), std::move(skyboxMeshIndices), vector<Texture>());
+    unsigned int cubemapTexture = loadCubeMap();
+
+    TrackFile trackFile;
+    if (!trackFile.Open(trackPath))
+        return EXIT_FAILURE;
+    Track track(trackFile);
+    glm::vec3 spawn = track.spawns[0];
+
+    // the car is at rest in the spawn position: chassis and wheels are placed like in the rig of the Vehicle class
+    glm::mat4 carMatrices[5];
+    Model* carModels[5] = { mModel, t1Model, t1Model, t2Model, t2Model };
+    glm::vec3 offsets[4] = { glm::vec3(-1.0f, -0.5f, -2.1f), glm::vec3(1.0f, -0.5f, -2.1f), glm::vec3(-1.0f, -0.5f, 1.6f), glm::vec3(1.0f, -0.5f, 1.6f) };
+    carMatrices[0] = glm::translate(glm::mat4(1.0f), spawn + glm::vec3(0.0f, 1.0f, 0.0f));
+    for (unsigned int i = 0; i < 4; i++) {
+        GLfloat side = (offsets[i].x < 0.0f) ? -1.0f : 1.0f;
+        carMatrices[i + 1] = glm::rotate(glm::translate(glm::mat4(1.0f), spawn + offsets[i] + glm::vec3(0.0f, 1.0f, 0.0f)), glm::radians(90.0f * side), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    Camera camera(glm::vec3(0.0f, 2.5f, 8.0f), GL_FALSE);
+    Frustum frustum;
+    vector<GLuint> visibleTiles;
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 10000.0f);
+    GLfloat trackRadius = glm::max(track.HalfWidth(), track.HalfHeight());
+
+    for (unsigned int frame = 0; frame < WARMUP_FRAMES + frames; frame++) {
+        bool measure = (frame >= WARMUP_FRAMES);
+        Clock::time_point frameStart = Clock::now();
+
+        // scripted camera path: orbit around the car, then around the whole track
+        GLfloat t = (GLfloat)(frame % frames) / frames;
+        glm::vec3 target;
+        GLfloat radius, height;
+        if (t < 0.5f) {
+            target = spawn;
+            radius = 8.0f;
+            height = 2.5f;
+            camera.Pitch = -10.0f;
+        } else {
+            target = glm::vec3(0.0f);
+            radius = trackRadius;
+            height = 0.5f * trackRadius;
+            camera.Pitch = -25.0f;
+        }
+        GLfloat angle = 4.0f * glm::pi<GLfloat>() * t;
+        camera.Position = target + glm::vec3(glm::cos(angle) * radius, height, glm::sin(angle) * radius);
+        camera.LookAt(-glm::cos(angle), 0.0f, -glm::sin(angle));
+
+        glm::mat4 view = camera.GetViewMatrix();
+        frustum.Update(projection, view);
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Terrain
+        timePass(PASS_TERRAIN, measure, [&]() {
+            tShader.Use();
+            tShader.setMat4("projection", projection);
+            tShader.setMat4("view", view);
+            tShader.setVec3("viewPos", camera.Position);
+            tShader.setVec3("light.direction", 1.0f, -0.5f, -0.5f);
+            tShader.setVec3("light.ambient", 0.473f, 0.428f, 0.322f);
+
+            track.VisibleTiles(frustum, visibleTiles);
+            for (unsigned int type = TILE_GRASS; type <= TILE_ASPHALT; type++) {
+                if (type == TILE_GRASS) {
+                    tShader.setFloat("material.shininess", 4.0f);
+                    tShader.setVec3("light.diffuse", 1.195f, 1.105f, 0.893f);
+                    tShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+                } else {
+                    tShader.setFloat("material.shininess", 16.0f);
+                    tShader.setVec3("light.diffuse", 0.945f, 0.855f, 0.643f);
+                    tShader.setVec3("light.specular", 2.75f, 2.75f, 2.75f);
+                }
+                Model* tileModel = (type == TILE_GRASS) ? tModel0 : tModel1;
+                for (unsigned int i = 0; i < visibleTiles.size(); i++) {
+                    if (track.Paved(visibleTiles[i]) != (type == TILE_ASPHALT))
+                        continue;
+                    glm::mat4 planeModelMatrix = glm::translate(glm::mat4(1.0f), track.Position(visibleTiles[i]));
+                    glUniformMatrix4fv(glGetUniformLocation(tShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
+                    tileModel->Draw(tShader);
+                }
+            }
+        });
+
+        // Car
+        timePass(PASS_CAR, measure, [&]() {
+            mShader.Use();
+            mShader.setMat4("projection", projection);
+            mShader.setMat4("view", view);
+            for (unsigned int i = 0; i < 5; i++) {
+                if (!frustum.IsVisible(carMatrices[i], carModels[i]->boundsMin, carModels[i]->boundsMax))
+                    continue;
+                glm::mat3 objNormalMatrix = glm::transpose(glm::inverse(glm::mat3(carMatrices[i])));
+                glUniformMatrix4fv(glGetUniformLocation(mShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(carMatrices[i]));
+                glUniformMatrix3fv(glGetUniformLocation(mShader.Program, "normal"), 1, GL_FALSE, glm::value_ptr(objNormalMatrix));
+
+                mShader.setVec3("lightColor", glm::vec3(1.0));
+                mShader.setVec3("lightPos", lightPos);
+                mShader.setVec3("viewPos", camera.Position);
+                mShader.setFloat("material.shininess", 128.0f);
+                mShader.setVec3("light.direction", 1.0f, -0.5f, -0.5f);
+                mShader.setVec3("light.ambient", 0.5f, 0.5f, 0.5f);
+                mShader.setVec3("light.diffuse", 0.945f, 0.855f, 0.643f);
+                mShader.setVec3("light.specular", 4.0f, 4.0f, 4.0f);
+
+                glActiveTexture(GL_TEXTURE3);
+                mShader.setInt("skybox", 3);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+                carModels[i]->Draw(mShader);
+            }
+        });
+
+        // Skybox
+        timePass(PASS_SKYBOX, measure, [&]() {
+            glDepthFunc(GL_LEQUAL);
+            sShader.Use();
+            sShader.setMat4("projection", projection);
+            sShader.setMat4("view", glm::mat4(glm::mat3(view)));
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            skyboxMesh.Draw(sShader);
+            glDepthFunc(GL_LESS);
+        });
+
+        if (measure)
+            frameTimes.push_back(chrono::duration<double, milli>(Clock::now() - frameStart).count());
+    }
+
+    // results
+    double totalFrames = 0.0;
+    for (unsigned int i = 0; i < frameTimes.size(); i++)
+        totalFrames += frameTimes[i];
+    cout << "{" << endl;
+    cout << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\"," << endl;
+    cout << "  \"width\": " << SCR_WIDTH << ", \"height\": " << SCR_HEIGHT << ", \"frames\": " << frames << "," << endl;
+    cout << "  \"fps\": " << (totalFrames > 0.0 ? 1000.0 * frameTimes.size() / totalFrames : 0.0) << "," << endl;
+    printStats("frame_ms", frameTimes, false);
+    for (int pass = 0; pass < PASSES; pass++) {
+        cout << "  \"" << passNames[pass] << "\": {" << endl;
+        printStats("submit_ms", submitTimes[pass], false);
+        printStats("total_ms", totalTimes[pass], true);
+        cout << "  }" << (pass + 1 < PASSES ? "," : "") << endl;
+    }
+    cout << "}" << endl;
+
+    skyboxMesh.Delete();
+    // the models release their ranges of the shared buffers, before the buffers are deleted
+    delete mModel;
+    delete t1Model;
+    delete t2Model;
+    delete tModel0;
+    delete tModel1;
+    GeometryArena::Static().Delete();
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    context.Destroy();
+    return EXIT_SUCCESS;
+}
+
+//////////////////////////////////////////
+// median and mean of the timings, as JSON members
+void printStats(const char* name, vector<double>& times, bool last) {
+    double mean = 0.0, median = 0.0;
+    if (!times.empty()) {
+        for (unsigned int i = 0; i < times.size(); i++)
+            mean += times[i];
+        mean /= times.size();
+        sort(times.begin(), times.end());
+        median = times[times.size() / 2];
+    }
+    cout << "    \"" << name << "\": { \"median\": " << median << ", \"mean\": " << mean << " }" << (last ? "" : ",") << endl;
+}
+
+//////////////////////////////////////////
+// same cube map of the application
+unsigned int loadCubeMap() {
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+    int width, height, channels;
+    unsigned char *data;
+    std::vector<std::string> txt_faces;
+    txt_faces.push_back("textures/clouds1/clouds1_east.bmp");
+    txt_faces.push_back("textures/clouds1/clouds1_west.bmp");
+    txt_faces.push_back("textures/clouds1/clouds1_up.bmp");
+    txt_faces.push_back("textures/clouds1/clouds1_down.bmp");
+    txt_faces.push_back("textures/clouds1/clouds1_north.bmp");
+    txt_faces.push_back("textures/clouds1/clouds1_south.bmp");
+    for (unsigned int i = 0; i < 6; i++) {
+        data = stbi_load(txt_faces[i].c_str(), &width, &height, &channels, 0);
+        glTexImage2D(
+            GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB,
+            width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
+        );
+        stbi_image_free(data);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    return textureID;
+}
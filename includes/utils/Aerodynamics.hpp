@@ -0,0 +1,63 @@
+/*
+Aerodynamics class - v1
+- aerodynamic drag: F = 1/2 * rho * Cd * A * v^2, against the velocity of the chassis
+- downforce on the front and rear axles: F = 1/2 * rho * Cl * A * v^2, with v the speed along the forward direction of the chassis
+
+The coefficients are per vehicle (see Vehicle class), and the forces are applied at each physics tick: the drag grows with the square of the speed, so the top speed is reached when it balances the drive force, and the downforce adds grip to the tyres at high speed.
+Front and rear downforce coefficients are separate, to tune the aerodynamic balance: more rear downforce makes the car more stable at high speed.
+
+N.B.) the class computes only the magnitudes of the forces: the Vehicle class applies the drag against the velocity of the chassis, and the downforce at the axles, along the down direction of the chassis
+*/
+
+#pragma once
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+
+///////////////////  Aerodynamics class ///////////////////////
+class Aerodynamics
+{
+public:
+    GLfloat airDensity;                     // kg/m^3
+    GLfloat dragCoefficient;                // Cd
+    GLfloat frontalArea;                    // m^2
+    GLfloat frontDownforce, rearDownforce;  // Cl of each axle
+
+    //////////////////////////////////////////
+    // constructor: a sports car with a small rear wing
+    Aerodynamics()
+    {
+        this->airDensity = 1.225f;
+        this->dragCoefficient = 0.35f;
+        this->frontalArea = 2.2f;
+        this->frontDownforce = 0.15f;
+        this->rearDownforce = 0.25f;
+    }
+
+    //////////////////////////////////////////
+    // magnitude of the drag at the given speed (N)
+    GLfloat Drag(GLfloat speed) const
+    {
+        return this->DragFactor() * speed * speed;
+    }
+
+    // magnitude of the downforce on an axle at the given forward speed (N)
+    GLfloat Downforce(GLfloat forwardSpeed, bool front) const
+    {
+        return this->DownforceFactor(front) * forwardSpeed * forwardSpeed;
+    }
+
+    //////////////////////////////////////////
+    // factors of the square of the speed (1/2 * rho * C * A), e.g., for the batch update of the VehicleStore class
+    GLfloat DragFactor() const
+    {
+        return 0.5f * this->airDensity * this->dragCoefficient * this->frontalArea;
+    }
+
+    GLfloat DownforceFactor(bool front) const
+    {
+        GLfloat coefficient = front ? this->frontDownforce : this->rearDownforce;
+        return 0.5f * this->airDensity * coefficient * this->frontalArea;
+    }
+};
@@ -0,0 +1,262 @@
+/*
+GeometryArena class - v1
+- a single VAO, VBO and EBO shared by all the static meshes of the application
+- sub-allocation of ranges of vertices and indices inside the buffers
+
+Every Mesh stores its data in a range of the shared buffers, and it is rendered using glDrawElementsBaseVertex (the indices of the mesh are relative to the first vertex of its range). All the meshes use the same vertex format (Vertex data structure), so the VAO is bound only once, and there are no VAO switches during the rendering of a frame.
+When the buffers are full, they are re-allocated with a doubled size, and the previous content is copied on the GPU side (glCopyBufferSubData).
+Released ranges are kept in a free list, and they are reused by following allocations (e.g., streamed terrain chunks).
+
+N.B.) the arena must be used only after the creation of the OpenGL context
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+// we use GLM data structures to write data in the VBO, VAO and EBO buffers
+#include <glm/glm.hpp>
+
+// data structure for vertices (the vertex format of the arena)
+struct Vertex {
+    // vertex coordinates
+    glm::vec3 Position;
+    // Normal
+    glm::vec3 Normal;
+    // Texture coordinates
+    glm::vec2 TexCoords;
+    // Tangent
+    glm::vec3 Tangent;
+    // Bitangent
+    glm::vec3 Bitangent;
+};
+
+// data structure for a range of elements (vertices or indices) inside the arena
+struct ArenaRange {
+    GLuint start;
+    GLuint count;
+};
+
+/////////////////// GEOMETRY ARENA class ///////////////////////
+class GeometryArena
+{
+public:
+    // shared VAO
+    GLuint VAO;
+
+    //////////////////////////////////////////
+    // the arena used by all the meshes of the application (created at first use)
+    static GeometryArena& Static()
+    {
+        static GeometryArena arena;
+        return arena;
+    }
+
+    //////////////////////////////////////////
+    // we copy vertices and indices in the shared buffers, and we return the ranges where they have been stored
+    void Allocate(const vector<Vertex>& vertices, const vector<GLuint>& indices, ArenaRange& vertexRange, ArenaRange& indexRange)
+    {
+        if (this->VAO == 0)
+            this->setupArena();
+
+        vertexRange = this->allocateRange(this->freeVertices, this->vertexCount, this->vertexCapacity, vertices.size(), GL_ARRAY_BUFFER);
+        indexRange = this->allocateRange(this->freeIndices, this->indexCount, this->indexCapacity, indices.size(), GL_ELEMENT_ARRAY_BUFFER);
+
+        // the VAO is bound also to update the EBO (its binding is part of the VAO state)
+        this->Bind();
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+        if (!vertices.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, vertexRange.start * sizeof(Vertex), vertices.size() * sizeof(Vertex), &vertices[0]);
+        if (!indices.empty())
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexRange.start * sizeof(GLuint), indices.size() * sizeof(GLuint), &indices[0]);
+    }
+
+    //////////////////////////////////////////
+    // the ranges are given back to the arena, and they can be reused by following allocations
+    void Free(ArenaRange vertexRange, ArenaRange indexRange)
+    {
+        this->releaseRange(this->freeVertices, vertexRange);
+        this->releaseRange(this->freeIndices, indexRange);
+    }
+
+    //////////////////////////////////////////
+    // the shared VAO is made "active" (only if it is not already bound)
+    void Bind()
+    {
+        if (!this->bound)
+        {
+            glBindVertexArray(this->VAO);
+            this->bound = true;
+        }
+    }
+
+    // other code has changed the current VAO: the next call to Bind must bind again the shared VAO
+    void Unbind()
+    {
+        glBindVertexArray(0);
+        this->bound = false;
+    }
+
+    //////////////////////////////////////////
+    // buffers are deallocated when application ends
+    void Delete()
+    {
+        glDeleteVertexArrays(1, &this->VAO);
+        glDeleteBuffers(1, &this->VBO);
+        glDeleteBuffers(1, &this->EBO);
+        this->VAO = this->VBO = this->EBO = 0;
+        this->vertexCount = this->indexCount = 0;
+        this->freeVertices.clear();
+        this->freeIndices.clear();
+        this->bound = false;
+    }
+
+private:
+    // shared VBO and EBO
+    GLuint VBO, EBO;
+    // number of elements allocated in the buffers, and size of the buffers (in elements)
+    GLuint vertexCount, vertexCapacity;
+    GLuint indexCount, indexCapacity;
+    // released ranges, sorted by start position
+    vector<ArenaRange> freeVertices;
+    vector<ArenaRange> freeIndices;
+    // true if the shared VAO is the current one
+    bool bound;
+
+    // initial size of the buffers (in elements)
+    static const GLuint INITIAL_VERTICES = 1 << 16;
+    static const GLuint INITIAL_INDICES = 1 << 18;
+
+    //////////////////////////////////////////
+    // the arena is empty until the first allocation
+    GeometryArena()
+        : VAO(0), VBO(0), EBO(0), vertexCount(0), vertexCapacity(0), indexCount(0), indexCapacity(0), bound(false)
+    {
+    }
+
+    GeometryArena(const GeometryArena&);
+    GeometryArena& operator=(const GeometryArena&);
+
+    //////////////////////////////////////////
+    // we create the shared buffers, and we set in the VAO the pointers to the different vertex attributes
+    void setupArena()
+    {
+        glGenVertexArrays(1, &this->VAO);
+        this->VBO = this->createBuffer(GL_ARRAY_BUFFER, INITIAL_VERTICES * sizeof(Vertex));
+        this->EBO = this->createBuffer(GL_ELEMENT_ARRAY_BUFFER, INITIAL_INDICES * sizeof(GLuint));
+        this->vertexCapacity = INITIAL_VERTICES;
+        this->indexCapacity = INITIAL_INDICES;
+
+        this->bound = false;
+        this->Bind();
+        this->setupAttributes();
+    }
+
+    // vertex attributes (with the relative offsets inside the Vertex data structure)
+    void setupAttributes()
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+        // vertex positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+        // Normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
+        // Texture Coordinates
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+        // Tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Tangent));
+        // Bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Bitangent));
+    }
+
+    GLuint createBuffer(GLenum target, GLsizeiptr size)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        glBufferData(target, size, NULL, GL_STATIC_DRAW);
+        return buffer;
+    }
+
+    //////////////////////////////////////////
+    // first-fit search in the free list, otherwise the range is taken at the end of the buffer (which is enlarged if needed)
+    ArenaRange allocateRange(vector<ArenaRange>& freeList, GLuint& count, GLuint& capacity, GLuint size, GLenum target)
+    {
+        ArenaRange range = { count, size };
+        for (GLuint i = 0; i < freeList.size(); i++)
+        {
+            if (freeList[i].count >= size)
+            {
+                range.start = freeList[i].start;
+                freeList[i].start += size;
+                freeList[i].count -= size;
+                if (freeList[i].count == 0)
+                    freeList.erase(freeList.begin() + i);
+                return range;
+            }
+        }
+
+        if (count + size > capacity)
+        {
+            GLuint newCapacity = capacity;
+            while (count + size > newCapacity)
+                newCapacity *= 2;
+            this->growBuffer(target, capacity, newCapacity);
+            capacity = newCapacity;
+        }
+        count += size;
+        return range;
+    }
+
+    // the range is inserted in the free list, and merged with the adjacent free ranges
+    void releaseRange(vector<ArenaRange>& freeList, ArenaRange range)
+    {
+        if (range.count == 0)
+            return;
+        GLuint i = 0;
+        while (i < freeList.size() && freeList[i].start < range.start)
+            i++;
+        freeList.insert(freeList.begin() + i, range);
+        if (i + 1 < freeList.size() && freeList[i].start + freeList[i].count == freeList[i+1].start)
+        {
+            freeList[i].count += freeList[i+1].count;
+            freeList.erase(freeList.begin() + i + 1);
+        }
+        if (i > 0 && freeList[i-1].start + freeList[i-1].count == freeList[i].start)
+        {
+            freeList[i-1].count += freeList[i].count;
+            freeList.erase(freeList.begin() + i);
+        }
+    }
+
+    //////////////////////////////////////////
+    // a bigger buffer is created, the content of the old one is copied on the GPU, and the VAO is updated
+    void growBuffer(GLenum target, GLuint oldCapacity, GLuint newCapacity)
+    {
+        GLsizeiptr elementSize = (target == GL_ARRAY_BUFFER) ? sizeof(Vertex) : sizeof(GLuint);
+        GLuint& buffer = (target == GL_ARRAY_BUFFER) ? this->VBO : this->EBO;
+
+        GLuint newBuffer;
+        glGenBuffers(1, &newBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * elementSize, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity * elementSize);
+        glDeleteBuffers(1, &buffer);
+        buffer = newBuffer;
+
+        this->bound = false;
+        this->Bind();
+        this->setupAttributes();
+    }
+};
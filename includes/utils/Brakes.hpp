@@ -0,0 +1,110 @@
+/*
+Brakes class - v1
+- brake torque of each wheel, with front/rear balance
+- anti-lock braking system (ABS): the brake torque of a wheel is released when the wheel is locking
+- traction control (TC): the drive torque of a wheel is reduced when the wheel is spinning
+
+Both controllers compare the speed of the tyre surface (spin * radius) with the speed of the chassis along its forward direction, and compute the slip ratio of each wheel:
+    slip = (spin * radius - speed) / max(|speed|, minSpeed)
+When the slip is beyond the threshold, the torque factor of the wheel decreases at releaseRate (1/s), otherwise it goes back to 1 at applyRate (1/s), like the modulation of a hydraulic valve.
+The controllers run at each physics tick (see Vehicle class), so their behaviour does not depend on the frame rate.
+
+N.B.) the brake torques are magnitudes, applied against the spin of the wheels by the caller, while traction control scales the signed drive torques of the Drivetrain class in place
+*/
+
+#pragma once
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+
+#include <utils/Drivetrain.hpp>
+
+///////////////////  Brakes class ///////////////////////
+class Brakes
+{
+public:
+    // maximum brake torque of the whole vehicle (Nm), and fraction on the front axle
+    GLfloat maxTorque;
+    GLfloat frontBias;
+
+    // controllers
+    bool abs, tc;
+    GLfloat absSlip, tcSlip;        // slip thresholds
+    GLfloat releaseRate, applyRate;
+    GLfloat minSpeed;               // m/s
+
+    // torque factors of the wheels (1 = full torque)
+    GLfloat brakeFactor[WHEELS];
+    GLfloat driveFactor[WHEELS];
+
+    //////////////////////////////////////////
+    // constructor: both controllers enabled
+    Brakes()
+    {
+        this->maxTorque = 6000.0f;
+        this->frontBias = 0.6f;
+        this->abs = true;
+        this->tc = true;
+        this->absSlip = 0.15f;
+        this->tcSlip = 0.15f;
+        this->releaseRate = 20.0f;
+        this->applyRate = 8.0f;
+        this->minSpeed = 1.0f;
+        this->Reset();
+    }
+
+    // controllers back to full torque on all the wheels (the settings are kept)
+    void Reset()
+    {
+        for (int i = 0; i < WHEELS; i++)
+            this->brakeFactor[i] = this->driveFactor[i] = 1.0f;
+    }
+
+    //////////////////////////////////////////
+    // slip ratio of a wheel, with the given minimum reference speed
+    static GLfloat Slip(GLfloat spin, GLfloat radius, GLfloat speed, GLfloat minSpeed)
+    {
+        return (spin * radius - speed) / glm::max(glm::abs(speed), minSpeed);
+    }
+
+    //////////////////////////////////////////
+    // one step of the controllers: brake pedal in [0, 1], speed of the chassis along its forward direction
+    // the drive torques are reduced by traction control, and the brake torques (always positive, they must be applied against the spin) are written in brakeTorque
+    void Step(const GLfloat wheelSpin[WHEELS], const GLfloat wheelRadius[WHEELS], GLfloat speed, GLfloat brake, GLfloat dt, GLfloat driveTorque[WHEELS], GLfloat brakeTorque[WHEELS])
+    {
+        GLfloat slip[WHEELS];
+        for (int i = 0; i < WHEELS; i++)
+            slip[i] = Slip(wheelSpin[i], wheelRadius[i], speed, this->minSpeed);
+        this->Step(slip, speed, brake, dt, driveTorque, brakeTorque);
+    }
+
+    // the same step, with the slip ratios of the wheels already computed (e.g., by the batch update of the VehicleStore class)
+    void Step(const GLfloat slip[WHEELS], GLfloat speed, GLfloat brake, GLfloat dt, GLfloat driveTorque[WHEELS], GLfloat brakeTorque[WHEELS])
+    {
+        for (int i = 0; i < WHEELS; i++) {
+            bool front = (i == WHEEL_FL || i == WHEEL_FR);
+
+            // ABS: the wheel is locking when it turns slower than the ground, in the direction of motion
+            GLfloat lockSlip = (speed >= 0.0f) ? -slip[i] : slip[i];
+            bool locking = this->abs && brake > 0.0f && lockSlip > this->absSlip;
+            this->brakeFactor[i] = this->modulate(this->brakeFactor[i], locking, dt);
+            brakeTorque[i] = brake * this->maxTorque * 0.5f * (front ? this->frontBias : 1.0f - this->frontBias) * this->brakeFactor[i];
+
+            // TC: the wheel is spinning when it turns faster than the ground, in the direction of the drive torque
+            GLfloat spinSlip = (driveTorque[i] >= 0.0f) ? slip[i] : -slip[i];
+            bool spinning = this->tc && driveTorque[i] != 0.0f && spinSlip > this->tcSlip;
+            this->driveFactor[i] = this->modulate(this->driveFactor[i], spinning, dt);
+            driveTorque[i] *= this->driveFactor[i];
+        }
+    }
+
+private:
+    // the factor decreases while the condition holds, otherwise it goes back to 1
+    GLfloat modulate(GLfloat factor, bool release, GLfloat dt) const
+    {
+        if (release)
+            return glm::max(0.0f, factor - this->releaseRate * dt);
+        return glm::min(1.0f, factor + this->applyRate * dt);
+    }
+};
@@ -0,0 +1,205 @@
+/*
+Drivetrain class - v1
+- engine with a torque curve (lookup table over the engine speed), rev limiter and engine braking
+- gearbox with automatic shifting (reverse + up to 6 forward gears) and final drive
+- automatic clutch, slipping at launch and open during the gear shifts
+- center differential with a fixed front/rear split, and axle differentials (open or limited slip)
+
+The drivetrain does not depend on Bullet: at each physics tick it receives the spin speed of the wheels and the throttle, and it returns the drive torque of each wheel (see Vehicle class). All the data are stored in fixed-size arrays inside the object, so an update has no allocations, and the cost is a few dozen floating point operations for each vehicle.
+
+The engine speed follows the wheels when the clutch is engaged (rigid drivetrain): this is stable with any time step, unlike the integration of an engine inertia coupled to the wheels by a stiff clutch.
+At launch (engine speed from the wheels below launchRpm), the clutch slips: the engine is kept at launchRpm, and the transmitted torque is limited by the clutch capacity.
+
+N.B. 1) speeds of the wheels and torques are positive in the forward direction
+N.B. 2) the torque curve is normalized (1 = peak torque), with a sample every rpmStep, starting from 0 rpm
+*/
+
+#pragma once
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// enum to identify the wheels of a vehicle
+enum wheelpositions { WHEEL_FL, WHEEL_FR, WHEEL_RL, WHEEL_RR, WHEELS };
+
+// enum to identify the differential types
+enum difftypes { DIFF_OPEN, DIFF_LIMITED_SLIP };
+
+///////////////////  Drivetrain class ///////////////////////
+class Drivetrain
+{
+public:
+    static const int TORQUE_SAMPLES = 15;
+    static const int MAX_GEARS = 7;
+
+    // Engine
+    GLfloat torqueCurve[TORQUE_SAMPLES];
+    GLfloat rpmStep;
+    GLfloat peakTorque;         // Nm
+    GLfloat idleRpm, redlineRpm;
+    GLfloat engineBraking;      // Nm at redline, with closed throttle
+
+    // Gearbox (gearRatios[0] is the reverse gear)
+    GLfloat gearRatios[MAX_GEARS];
+    int gearCount;              // number of forward gears
+    GLfloat finalDrive;
+    GLfloat upshiftRpm, downshiftRpm;
+    GLfloat shiftTime;          // seconds with the clutch open during a shift
+
+    // Clutch
+    GLfloat launchRpm;
+    GLfloat clutchCapacity;     // Nm
+
+    // Differentials
+    GLfloat frontSplit;         // fraction of the torque sent to the front axle
+    int frontDiff, rearDiff;
+    GLfloat lsdStiffness;       // Nm of torque transfer for each rad/s of speed difference
+    GLfloat lsdBias;            // maximum transfer, as a fraction of the axle torque
+
+    // State
+    int gear;                   // 0 = reverse, 1..gearCount = forward gears
+    GLfloat rpm;
+    GLfloat shiftTimer;
+
+    //////////////////////////////////////////
+    // constructor: a V8 muscle car with a 5-speed gearbox and all-wheel drive
+    Drivetrain()
+    {
+        const GLfloat curve[TORQUE_SAMPLES] = {
+            // 0 - 3000 rpm
+            0.45f, 0.60f, 0.72f, 0.82f, 0.90f, 0.96f, 1.00f,
+            // 3500 - 7000 rpm
+            1.00f, 0.98f, 0.95f, 0.90f, 0.84f, 0.76f, 0.65f, 0.50f
+        };
+        for (int i = 0; i < TORQUE_SAMPLES; i++)
+            this->torqueCurve[i] = curve[i];
+        this->rpmStep = 500.0f;
+        this->peakTorque = 500.0f;
+        this->idleRpm = 900.0f;
+        this->redlineRpm = 6500.0f;
+        this->engineBraking = 60.0f;
+
+        const GLfloat ratios[MAX_GEARS] = { 2.90f, 2.66f, 1.78f, 1.30f, 1.00f, 0.74f, 0.0f };
+        for (int i = 0; i < MAX_GEARS; i++)
+            this->gearRatios[i] = ratios[i];
+        this->gearCount = 5;
+        this->finalDrive = 3.42f;
+        this->upshiftRpm = 6000.0f;
+        this->downshiftRpm = 2500.0f;
+        this->shiftTime = 0.2f;
+
+        this->launchRpm = 2500.0f;
+        this->clutchCapacity = 800.0f;
+
+        this->frontSplit = 0.5f;
+        this->frontDiff = DIFF_OPEN;
+        this->rearDiff = DIFF_LIMITED_SLIP;
+        this->lsdStiffness = 50.0f;
+        this->lsdBias = 0.5f;
+
+        this->Reset();
+    }
+
+    // state back to the start: first gear, engine at idle (the settings are kept)
+    void Reset()
+    {
+        this->gear = 1;
+        this->rpm = this->idleRpm;
+        this->shiftTimer = 0.0f;
+    }
+
+    //////////////////////////////////////////
+    // normalized engine torque at the given speed (linear interpolation of the table)
+    GLfloat CurveAt(GLfloat engineRpm) const
+    {
+        GLfloat x = glm::clamp(engineRpm / this->rpmStep, 0.0f, (GLfloat)(TORQUE_SAMPLES - 1));
+        int i = glm::min((int)x, TORQUE_SAMPLES - 2);
+        return glm::mix(this->torqueCurve[i], this->torqueCurve[i + 1], x - i);
+    }
+
+    //////////////////////////////////////////
+    // one step of the drivetrain: throttle in [-1, 1] (negative values drive in reverse), spin of the wheels in rad/s
+    // the drive torque of each wheel is written in torque
+    void Step(const GLfloat wheelSpin[WHEELS], GLfloat throttle, bool handbrake, GLfloat dt, GLfloat torque[WHEELS])
+    {
+        const GLfloat toRpm = 60.0f / (2.0f * glm::pi<GLfloat>());
+        // with the handbrake pulled, all the torque goes to the front axle
+        GLfloat frontShare = handbrake ? 1.0f : this->frontSplit;
+        GLfloat rearShare = handbrake ? 0.0f : 1.0f - this->frontSplit;
+
+        // spin of the driven wheels (average, weighted by their share of torque: the rear wheels locked by the handbrake do not count)
+        GLfloat spin = frontShare * 0.5f * (wheelSpin[WHEEL_FL] + wheelSpin[WHEEL_FR])
+            + rearShare * 0.5f * (wheelSpin[WHEEL_RL] + wheelSpin[WHEEL_RR]);
+
+        // reverse gear is selected only when the car is (almost) stopped
+        if (throttle < 0.0f && this->gear != 0 && spin < 1.0f)
+            this->selectGear(0);
+        else if (throttle > 0.0f && this->gear == 0 && spin > -1.0f)
+            this->selectGear(1);
+
+        GLfloat ratio = this->gearRatios[this->gear] * this->finalDrive;
+        GLfloat direction = (this->gear == 0) ? -1.0f : 1.0f;
+        // throttle in the opposite direction of the gear (e.g., reverse requested while the car is still moving forward): no drive
+        GLfloat pedal = ((throttle < 0.0f) == (this->gear == 0)) ? glm::abs(throttle) : 0.0f;
+
+        // engine speed from the wheels (rigid drivetrain)
+        GLfloat wheelRpm = direction * spin * ratio * toRpm;
+
+        // automatic shifting
+        if (this->gear > 0 && this->shiftTimer <= 0.0f) {
+            if (wheelRpm > this->upshiftRpm && this->gear < this->gearCount)
+                this->selectGear(this->gear + 1);
+            else if (wheelRpm < this->downshiftRpm && this->gear > 1)
+                this->selectGear(this->gear - 1);
+        }
+
+        GLfloat driveTorque = 0.0f;
+        if (this->shiftTimer > 0.0f) {
+            // clutch open: the engine goes back to idle
+            this->shiftTimer -= dt;
+            this->rpm = glm::max(this->idleRpm, glm::mix(this->rpm, this->idleRpm, glm::min(1.0f, 5.0f * dt)));
+        } else if (wheelRpm < this->launchRpm && pedal > 0.0f) {
+            // clutch slipping: the engine is kept at launch speed
+            this->rpm = glm::mix(this->idleRpm, this->launchRpm, pedal);
+            driveTorque = glm::min(this->CurveAt(this->rpm) * this->peakTorque * pedal, this->clutchCapacity);
+        } else {
+            // clutch engaged
+            this->rpm = glm::max(wheelRpm, this->idleRpm);
+            if (this->rpm >= this->redlineRpm)
+                driveTorque = 0.0f;    // rev limiter
+            else if (pedal > 0.0f)
+                driveTorque = this->CurveAt(this->rpm) * this->peakTorque * pedal;
+            else if (wheelRpm > this->idleRpm)
+                driveTorque = -this->engineBraking * this->rpm / this->redlineRpm;
+        }
+
+        // torque at the wheels, split between the axles
+        GLfloat total = direction * driveTorque * ratio;
+        this->axle(total * frontShare, wheelSpin[WHEEL_FL], wheelSpin[WHEEL_FR], this->frontDiff, torque[WHEEL_FL], torque[WHEEL_FR]);
+        this->axle(total * rearShare, wheelSpin[WHEEL_RL], wheelSpin[WHEEL_RR], this->rearDiff, torque[WHEEL_RL], torque[WHEEL_RR]);
+    }
+
+private:
+    //////////////////////////////////////////
+    // gear change: the clutch is opened for shiftTime seconds
+    void selectGear(int newGear)
+    {
+        this->gear = newGear;
+        this->shiftTimer = this->shiftTime;
+    }
+
+    //////////////////////////////////////////
+    // axle differential: the open differential splits the torque equally, the limited slip one moves torque from the faster wheel to the slower one
+    void axle(GLfloat axleTorque, GLfloat spinLeft, GLfloat spinRight, int type, GLfloat& left, GLfloat& right) const
+    {
+        left = right = 0.5f * axleTorque;
+        if (type == DIFF_LIMITED_SLIP) {
+            GLfloat limit = this->lsdBias * 0.5f * glm::abs(axleTorque);
+            GLfloat transfer = glm::clamp(this->lsdStiffness * (spinLeft - spinRight), -limit, limit);
+            left -= transfer;
+            right += transfer;
+        }
+    }
+};
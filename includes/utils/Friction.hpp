@@ -0,0 +1,78 @@
+/*
+FrictionTable class - v1
+- friction model for the contacts between tyres and terrain, based on the pair (tyre type, surface type)
+- for each pair: grip factor, and rolling resistance
+
+The tyre type of a body is stored in its user index (-1, the Bullet default, for bodies which are not tyres), and the surface type is part of the SurfaceMaterial of the terrain. When a contact is created, the material callback (see Terrain class) looks up the pair in the table, and sets friction and rolling friction of the contact point.
+The table is a flat array of TyreSurface entries (8 bytes each), indexed by tyre*SURFACE_NONE + surface: all the pairs fit in one or two cache lines, and the lookup is a single indexed load.
+
+The grip factor multiplies the friction of the tyre body (set by the user), so the same tyre has different grip on different surfaces. The rolling resistance is the rolling friction coefficient used by Bullet for the contact.
+
+N.B.) contacts between bodies which are not tyres, or with surfaces without a type (e.g., walls), use the default rule (product of the friction coefficients)
+*/
+
+#pragma once
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+
+#include <utils/TrackFile.hpp>
+
+// enum to identify the tyre types (stored in the user index of the tyre bodies)
+enum tyretypes { TYRE_ROAD, TYRE_OFFROAD, TYRE_TYPES };
+
+// friction parameters of a tyre on a surface
+struct TyreSurface {
+    GLfloat grip;
+    GLfloat rolling;
+};
+
+/////////////////// FRICTION TABLE class ///////////////////////
+class FrictionTable
+{
+public:
+    //////////////////////////////////////////
+    // the table used by the material callback (created at first use, with the default values)
+    static FrictionTable& Static()
+    {
+        static FrictionTable table;
+        return table;
+    }
+
+    //////////////////////////////////////////
+    // parameters of the pair (the caller must check that the types are valid)
+    const TyreSurface& Lookup(int tyre, unsigned int surface) const
+    {
+        return this->pairs[tyre * SURFACE_NONE + surface];
+    }
+
+    // we change the parameters of a pair
+    void Set(int tyre, unsigned int surface, GLfloat grip, GLfloat rolling)
+    {
+        TyreSurface pair = { grip, rolling };
+        this->pairs[tyre * SURFACE_NONE + surface] = pair;
+    }
+
+private:
+    // flat array of all the pairs
+    TyreSurface pairs[TYRE_TYPES * SURFACE_NONE];
+
+    //////////////////////////////////////////
+    // default values: the grip of the road tyres on grass and asphalt is the same of the previous friction coefficients of the terrain
+    FrictionTable()
+    {
+        // tyre type, surface type, grip factor, rolling resistance
+        this->Set(TYRE_ROAD, SURFACE_GRASS,     0.25f, 0.030f);
+        this->Set(TYRE_ROAD, SURFACE_ASPHALT,   0.50f, 0.005f);
+        this->Set(TYRE_ROAD, SURFACE_WET,       0.35f, 0.006f);
+        this->Set(TYRE_ROAD, SURFACE_GRAVEL,    0.30f, 0.020f);
+
+        this->Set(TYRE_OFFROAD, SURFACE_GRASS,   0.35f, 0.020f);
+        this->Set(TYRE_OFFROAD, SURFACE_ASPHALT, 0.45f, 0.008f);
+        this->Set(TYRE_OFFROAD, SURFACE_WET,     0.32f, 0.009f);
+        this->Set(TYRE_OFFROAD, SURFACE_GRAVEL,  0.40f, 0.012f);
+    }
+
+    FrictionTable(const FrictionTable&);
+    FrictionTable& operator=(const FrictionTable&);
+};
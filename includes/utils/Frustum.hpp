@@ -0,0 +1,173 @@
+/*
+Frustum class - v1
+- extraction of the 6 planes of the view frustum from the projection and view matrices
+- visibility test of axis-aligned bounding boxes, with counters of tested and culled objects
+
+The planes are stored as a structure of arrays (4 planes for each SSE register, the last 2 are padding planes which never cull anything), so an AABB is tested against all the planes with a few SIMD instructions.
+For each plane, we consider the vertex of the box farthest along the plane normal: the box is outside the frustum if this vertex is behind at least one plane.
+If SSE is not available, the same test is computed in a scalar loop.
+
+N.B.) the planes are extracted with the Gribb-Hartmann method, they do not need to be normalized because we test only the sign of the distance
+*/
+
+#pragma once
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+// result of the classification of a box with respect to the frustum
+enum frustumtest { FRUSTUM_OUTSIDE, FRUSTUM_INTERSECT, FRUSTUM_INSIDE };
+
+///////////////////  FRUSTUM class ///////////////////////
+class Frustum
+{
+public:
+    // number of objects tested, and number of objects found outside the frustum (since the last reset)
+    GLuint tested;
+    GLuint culled;
+
+    //////////////////////////////////////////
+    // constructor
+    Frustum()
+    {
+        this->tested = 0;
+        this->culled = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            this->nx[i] = this->ny[i] = this->nz[i] = 0.0f;
+            this->d[i] = 1.0f;
+        }
+    }
+
+    //////////////////////////////////////////
+    // we extract the planes from the combined matrix (projection * view)
+    void Update(const glm::mat4& projection, const glm::mat4& view)
+    {
+        glm::mat4 m = projection * view;
+        // rows of the matrix (GLM matrices are stored by columns)
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        // left, right, bottom, top, near, far
+        this->setPlane(0, row3 + row0);
+        this->setPlane(1, row3 - row0);
+        this->setPlane(2, row3 + row1);
+        this->setPlane(3, row3 - row1);
+        this->setPlane(4, row3 + row2);
+        this->setPlane(5, row3 - row2);
+    }
+
+    //////////////////////////////////////////
+    // the counters are set to 0 (e.g., at the beginning of each frame)
+    void ResetCounters()
+    {
+        this->tested = 0;
+        this->culled = 0;
+    }
+
+    //////////////////////////////////////////
+    // visibility test of an AABB in world coordinates
+    bool IsVisible(const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        bool visible = (this->classifyBox(boxMin, boxMax, false) != FRUSTUM_OUTSIDE);
+        this->tested++;
+        if (!visible)
+            this->culled++;
+        return visible;
+    }
+
+    //////////////////////////////////////////
+    // visibility test of an AABB in model coordinates, transformed with the model matrix
+    // (the result is the AABB containing the transformed box)
+    bool IsVisible(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        glm::vec3 center = glm::vec3(model * glm::vec4((boxMin + boxMax) * 0.5f, 1.0f));
+        glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+        glm::mat3 rot = glm::mat3(model);
+        glm::vec3 worldExtent = glm::abs(rot[0]) * extent.x + glm::abs(rot[1]) * extent.y + glm::abs(rot[2]) * extent.z;
+        return this->IsVisible(center - worldExtent, center + worldExtent);
+    }
+
+    //////////////////////////////////////////
+    // classification of an AABB in world coordinates: outside, intersecting, or completely inside the frustum
+    // (used by hierarchical structures: the content of a node completely inside does not need further tests)
+    // N.B.) the counters are not updated, the caller must update them
+    int Classify(const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        return this->classifyBox(boxMin, boxMax, true);
+    }
+
+private:
+    // planes as structure of arrays: normal components and distance (6 planes + 2 padding planes)
+    alignas(16) float nx[8];
+    alignas(16) float ny[8];
+    alignas(16) float nz[8];
+    alignas(16) float d[8];
+
+    void setPlane(int i, const glm::vec4& plane)
+    {
+        this->nx[i] = plane.x;
+        this->ny[i] = plane.y;
+        this->nz[i] = plane.z;
+        this->d[i] = plane.w;
+    }
+
+    //////////////////////////////////////////
+    // for each plane, the farthest vertex along the normal gives max(n.x*min.x, n.x*max.x) + ... + d
+    // if it is behind a plane, the box is outside. If required, the nearest vertex (min instead of max) is used to check if the box is completely inside
+    int classifyBox(const glm::vec3& boxMin, const glm::vec3& boxMax, bool checkInside)
+    {
+#ifdef FRUSTUM_SSE
+        __m128 minX = _mm_set1_ps(boxMin.x), maxX = _mm_set1_ps(boxMax.x);
+        __m128 minY = _mm_set1_ps(boxMin.y), maxY = _mm_set1_ps(boxMax.y);
+        __m128 minZ = _mm_set1_ps(boxMin.z), maxZ = _mm_set1_ps(boxMax.z);
+        int outside = 0, intersect = 0;
+        for (int i = 0; i < 8; i += 4)
+        {
+            __m128 px = _mm_load_ps(&this->nx[i]);
+            __m128 py = _mm_load_ps(&this->ny[i]);
+            __m128 pz = _mm_load_ps(&this->nz[i]);
+            __m128 dist = _mm_load_ps(&this->d[i]);
+            __m128 xMin = _mm_mul_ps(px, minX), xMax = _mm_mul_ps(px, maxX);
+            __m128 yMin = _mm_mul_ps(py, minY), yMax = _mm_mul_ps(py, maxY);
+            __m128 zMin = _mm_mul_ps(pz, minZ), zMax = _mm_mul_ps(pz, maxZ);
+            __m128 farDist = _mm_add_ps(dist, _mm_add_ps(_mm_max_ps(xMin, xMax), _mm_add_ps(_mm_max_ps(yMin, yMax), _mm_max_ps(zMin, zMax))));
+            outside |= _mm_movemask_ps(_mm_cmplt_ps(farDist, _mm_setzero_ps()));
+            if (checkInside)
+            {
+                __m128 nearDist = _mm_add_ps(dist, _mm_add_ps(_mm_min_ps(xMin, xMax), _mm_add_ps(_mm_min_ps(yMin, yMax), _mm_min_ps(zMin, zMax))));
+                intersect |= _mm_movemask_ps(_mm_cmplt_ps(nearDist, _mm_setzero_ps()));
+            }
+        }
+        if (outside)
+            return FRUSTUM_OUTSIDE;
+        return (!checkInside || intersect) ? FRUSTUM_INTERSECT : FRUSTUM_INSIDE;
+#else
+        int result = FRUSTUM_INSIDE;
+        for (int i = 0; i < 6; i++)
+        {
+            float farDist = this->d[i]
+                + glm::max(this->nx[i] * boxMin.x, this->nx[i] * boxMax.x)
+                + glm::max(this->ny[i] * boxMin.y, this->ny[i] * boxMax.y)
+                + glm::max(this->nz[i] * boxMin.z, this->nz[i] * boxMax.z);
+            if (farDist < 0.0f)
+                return FRUSTUM_OUTSIDE;
+            float nearDist = this->d[i]
+                + glm::min(this->nx[i] * boxMin.x, this->nx[i] * boxMax.x)
+                + glm::min(this->ny[i] * boxMin.y, this->ny[i] * boxMax.y)
+                + glm::min(this->nz[i] * boxMin.z, this->nz[i] * boxMax.z);
+            if (nearDist < 0.0f)
+                result = FRUSTUM_INTERSECT;
+        }
+        return checkInside ? result : FRUSTUM_INTERSECT;
+#endif
+    }
+};
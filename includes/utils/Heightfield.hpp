@@ -0,0 +1,459 @@
+/*
+HeightfieldTerrain class - v1
+- terrain with elevation, read from a memory-mapped height/material file
+- the terrain is divided in square chunks: only the chunks around the vehicle are loaded, both for rendering (a grid mesh) and for physics (btHeightfieldTerrainShape)
+- chunks are prepared on a background thread, and added to the scene (OpenGL buffers, rigid body) on the main thread
+
+The file is never copied in memory: it is mapped with mmap, and the loader thread reads only the samples of the requested chunks. The materials are read directly from the mapped file by the material callback (see Terrain class), using the cell coordinates provided by Bullet for the heightfield triangles.
+The memory used by the terrain is bounded by the number of loaded chunks: (2*radius+1)^2 chunks are requested around the vehicle, and the chunks farther than radius+1 are evicted (the extra ring avoids reloading when the vehicle moves back and forth across a chunk border).
+
+File format (little endian):
+- header (HeightfieldHeader data structure)
+- heights: width*height signed 16 bit values, row by row along the z axis (height in meters = heightOffset + heightScale * value)
+- materials: width*height unsigned 8 bit values (index in the materials vector, for the cell starting at the same sample)
+
+N.B. 1) the terrain is centered in the origin of the world
+N.B. 2) OpenGL and the dynamics world are used only by the main thread
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// memory mapping of files
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+
+#include <utils/Shader.hpp>
+#include <utils/Model.hpp>
+#include <utils/Frustum.hpp>
+#include <utils/Physics.hpp>
+#include <utils/Terrain.hpp>
+
+// header of the heightfield file
+struct HeightfieldHeader {
+    char magic[4];          // "HFLD"
+    uint32_t width;         // number of samples along x
+    uint32_t height;        // number of samples along z
+    float cellSize;         // distance between samples (meters)
+    float heightScale;      // meters for each unit of the stored heights
+    float heightOffset;     // height of the stored value 0 (meters)
+};
+
+/////////////////// HEIGHTFIELD CHUNK class ///////////////////////
+// a square portion of the terrain, with its mesh and its rigid body
+class HeightfieldChunk : public SurfaceMap
+{
+public:
+    // chunk coordinates
+    GLint cx, cz;
+    // number of samples of the chunk along x and z
+    GLuint samplesX, samplesZ;
+    // heights of the samples (used by the Collision Shape, so they must live as long as the chunk)
+    vector<float> heights;
+    GLfloat minHeight, maxHeight;
+    // world position of the first sample
+    glm::vec3 origin;
+    // mesh data, prepared by the loader thread and moved into the Mesh when the chunk is added to the scene
+    vector<Vertex> vertices;
+    vector<GLuint> indices;
+    // rendering and physics data (created by the main thread)
+    Mesh* mesh;
+    btRigidBody* body;
+
+    // materials of the cells, read from the mapped file (materials[z*stride + x])
+    const unsigned char* materialData;
+    GLuint stride;
+    const vector<SurfaceMaterial>* materials;
+
+    HeightfieldChunk() : mesh(NULL), body(NULL) {}
+
+    //////////////////////////////////////////
+    // material of the cell of the chunk containing the triangle (Bullet gives the cell coordinates as partId and index)
+    const SurfaceMaterial& Surface(int x, int z) const
+    {
+        x = glm::clamp(x, 0, (int)this->samplesX - 1);
+        z = glm::clamp(z, 0, (int)this->samplesZ - 1);
+        unsigned char m = this->materialData[z * this->stride + x];
+        if (m >= this->materials->size())
+            m = 0;
+        return (*this->materials)[m];
+    }
+};
+
+/////////////////// HEIGHTFIELD TERRAIN class ///////////////////////
+class HeightfieldTerrain
+{
+public:
+    // physical properties of the surfaces, indexed by the material values of the file
+    vector<SurfaceMaterial> materials;
+    // number of chunks loaded around the vehicle in each direction
+    GLint radius;
+
+    // number of cells along each side of a chunk
+    static const GLint CHUNK_CELLS = 64;
+
+    //////////////////////////////////////////
+    // constructor: the textures are used for the meshes of all the chunks
+    HeightfieldTerrain(Physics& simulation, const vector<Texture>& textures, GLint radius = 2)
+        : simulation(simulation), textures(textures)
+    {
+        this->radius = radius;
+        this->data = NULL;
+        this->size = 0;
+        this->header = NULL;
+        this->stopping = false;
+
+        // default materials: grass, asphalt (as in the tiled track)
+        SurfaceMaterial grass = { 0.25f, 0.25f, SURFACE_GRASS };
+        SurfaceMaterial asphalt = { 0.5f, 0.5f, SURFACE_ASPHALT };
+        this->materials.push_back(grass);
+        this->materials.push_back(asphalt);
+    }
+
+    //////////////////////////////////////////
+    // destructor: we stop the loader thread, we remove all the chunks, and we unmap the file
+    virtual ~HeightfieldTerrain()
+    {
+        {
+            lock_guard<mutex> lock(this->mtx);
+            this->stopping = true;
+        }
+        this->requestCv.notify_all();
+        if (this->loader.joinable())
+            this->loader.join();
+
+        for (map<pair<GLint, GLint>, HeightfieldChunk*>::iterator it = this->chunks.begin(); it != this->chunks.end(); ++it)
+            this->destroyChunk(it->second);
+        for (GLuint i = 0; i < this->ready.size(); i++)
+            delete this->ready[i];
+
+        if (this->data)
+            munmap(this->data, this->size);
+    }
+
+    //////////////////////////////////////////
+    // we map the file in memory, we check its content, and we start the loader thread
+    bool Open(const char* path)
+    {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            cout << "ERROR::HEIGHTFIELD:: cannot open " << path << endl;
+            return false;
+        }
+        struct stat info;
+        fstat(fd, &info);
+        this->size = info.st_size;
+        void* mapped = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping is still valid after closing the file
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            cout << "ERROR::HEIGHTFIELD:: cannot map " << path << endl;
+            return false;
+        }
+        this->data = (unsigned char*)mapped;
+
+        this->header = (const HeightfieldHeader*)this->data;
+        size_t samples = (this->size >= sizeof(HeightfieldHeader)) ? (size_t)this->header->width * this->header->height : 0;
+        if (this->size < sizeof(HeightfieldHeader) || memcmp(this->header->magic, "HFLD", 4) != 0
+            || this->header->width < 2 || this->header->height < 2
+            || this->size < sizeof(HeightfieldHeader) + samples * (sizeof(int16_t) + sizeof(uint8_t))) {
+            cout << "ERROR::HEIGHTFIELD:: invalid file " << path << endl;
+            munmap(this->data, this->size);
+            this->data = NULL;
+            this->header = NULL;
+            return false;
+        }
+        this->heightData = (const int16_t*)(this->data + sizeof(HeightfieldHeader));
+        this->materialData = this->data + sizeof(HeightfieldHeader) + samples * sizeof(int16_t);
+
+        // the advice to the kernel: samples are read in chunks, not sequentially
+        madvise(this->data, this->size, MADV_RANDOM);
+
+        this->loader = thread(&HeightfieldTerrain::loaderLoop, this);
+        return true;
+    }
+
+    //////////////////////////////////////////
+    // we request the chunks around the position, we evict the far ones, and we add to the scene the chunks prepared by the loader thread
+    // if wait is true, the method returns when all the requested chunks have been added (e.g., before the vehicle is spawned)
+    void Update(const glm::vec3& center, bool wait = false)
+    {
+        if (!this->header)
+            return;
+
+        GLint ccx, ccz;
+        this->chunkAt(center, ccx, ccz);
+
+        // evict the chunks too far from the center
+        map<pair<GLint, GLint>, HeightfieldChunk*>::iterator it = this->chunks.begin();
+        while (it != this->chunks.end()) {
+            if (abs(it->first.first - ccx) > this->radius + 1 || abs(it->first.second - ccz) > this->radius + 1) {
+                this->destroyChunk(it->second);
+                this->chunks.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+
+        // request the missing chunks
+        {
+            lock_guard<mutex> lock(this->mtx);
+            for (GLint dz = -this->radius; dz <= this->radius; dz++) {
+                for (GLint dx = -this->radius; dx <= this->radius; dx++) {
+                    pair<GLint, GLint> key(ccx + dx, ccz + dz);
+                    if (key.first < 0 || key.second < 0 || key.first >= this->chunksX() || key.second >= this->chunksZ())
+                        continue;
+                    if (this->chunks.count(key) || this->pending.count(key))
+                        continue;
+                    this->pending.insert(key);
+                    this->requests.push_back(key);
+                }
+            }
+        }
+        this->requestCv.notify_one();
+
+        // add the chunks prepared by the loader thread
+        vector<HeightfieldChunk*> loaded;
+        {
+            unique_lock<mutex> lock(this->mtx);
+            if (wait)
+                this->readyCv.wait(lock, [this]{ return this->requests.empty() && this->pending.size() == this->ready.size(); });
+            loaded.swap(this->ready);
+            for (GLuint i = 0; i < loaded.size(); i++)
+                this->pending.erase(make_pair(loaded[i]->cx, loaded[i]->cz));
+        }
+        for (GLuint i = 0; i < loaded.size(); i++) {
+            pair<GLint, GLint> key(loaded[i]->cx, loaded[i]->cz);
+            // the vehicle could have moved away while the chunk was loading
+            if (abs(key.first - ccx) > this->radius + 1 || abs(key.second - ccz) > this->radius + 1) {
+                delete loaded[i];
+                continue;
+            }
+            this->addChunk(loaded[i]);
+            this->chunks[key] = loaded[i];
+        }
+    }
+
+    //////////////////////////////////////////
+    // rendering of the loaded chunks inside the view frustum
+    void Draw(Shader& shader, Frustum& frustum, glm::vec3 renderOrigin = glm::vec3(0.0f))
+    {
+        for (map<pair<GLint, GLint>, HeightfieldChunk*>::iterator it = this->chunks.begin(); it != this->chunks.end(); ++it) {
+            HeightfieldChunk* chunk = it->second;
+            glm::vec3 boxMin = chunk->origin + glm::vec3(0.0f, chunk->minHeight, 0.0f);
+            glm::vec3 boxMax = chunk->origin + glm::vec3((chunk->samplesX - 1) * this->header->cellSize, chunk->maxHeight, (chunk->samplesZ - 1) * this->header->cellSize);
+            if (!frustum.IsVisible(boxMin, boxMax))
+                continue;
+            glm::mat4 chunkModelMatrix = glm::translate(glm::mat4(1.0f), chunk->origin - renderOrigin);
+            glUniformMatrix4fv(glGetUniformLocation(shader.Program, "model"), 1, GL_FALSE, glm::value_ptr(chunkModelMatrix));
+            chunk->mesh->Draw(shader);
+        }
+    }
+
+    //////////////////////////////////////////
+    // height of the terrain in a world position (bilinear interpolation of the samples)
+    GLfloat HeightAt(GLfloat x, GLfloat z) const
+    {
+        if (!this->header)
+            return 0.0f;
+        GLfloat fx = glm::clamp((x - this->firstSampleX()) / this->header->cellSize, 0.0f, (GLfloat)(this->header->width - 1));
+        GLfloat fz = glm::clamp((z - this->firstSampleZ()) / this->header->cellSize, 0.0f, (GLfloat)(this->header->height - 1));
+        GLint ix = glm::min((GLint)fx, (GLint)this->header->width - 2);
+        GLint iz = glm::min((GLint)fz, (GLint)this->header->height - 2);
+        GLfloat tx = fx - ix, tz = fz - iz;
+        GLfloat h0 = glm::mix(this->sample(ix, iz), this->sample(ix + 1, iz), tx);
+        GLfloat h1 = glm::mix(this->sample(ix, iz + 1), this->sample(ix + 1, iz + 1), tx);
+        return glm::mix(h0, h1, tz);
+    }
+
+    // number of chunks currently in memory
+    GLuint LoadedChunks() const { return this->chunks.size(); }
+
+private:
+    Physics& simulation;
+    vector<Texture> textures;
+
+    // mapped file
+    unsigned char* data;
+    size_t size;
+    const HeightfieldHeader* header;
+    const int16_t* heightData;
+    const unsigned char* materialData;
+
+    // loaded chunks (used only by the main thread)
+    map<pair<GLint, GLint>, HeightfieldChunk*> chunks;
+
+    // communication with the loader thread (protected by the mutex)
+    thread loader;
+    mutex mtx;
+    condition_variable requestCv, readyCv;
+    deque<pair<GLint, GLint> > requests;
+    set<pair<GLint, GLint> > pending;
+    vector<HeightfieldChunk*> ready;
+    bool stopping;
+
+    //////////////////////////////////////////
+    // number of chunks along x and z
+    GLint chunksX() const { return (this->header->width - 2) / CHUNK_CELLS + 1; }
+    GLint chunksZ() const { return (this->header->height - 2) / CHUNK_CELLS + 1; }
+
+    // world position of the first sample
+    GLfloat firstSampleX() const { return -0.5f * (this->header->width - 1) * this->header->cellSize; }
+    GLfloat firstSampleZ() const { return -0.5f * (this->header->height - 1) * this->header->cellSize; }
+
+    // chunk containing a world position
+    void chunkAt(const glm::vec3& pos, GLint& cx, GLint& cz) const
+    {
+        cx = (GLint)glm::floor((pos.x - this->firstSampleX()) / (this->header->cellSize * CHUNK_CELLS));
+        cz = (GLint)glm::floor((pos.z - this->firstSampleZ()) / (this->header->cellSize * CHUNK_CELLS));
+    }
+
+    // height of a sample (read from the mapped file)
+    GLfloat sample(GLint x, GLint z) const
+    {
+        x = glm::clamp(x, 0, (GLint)this->header->width - 1);
+        z = glm::clamp(z, 0, (GLint)this->header->height - 1);
+        return this->header->heightOffset + this->header->heightScale * this->heightData[z * this->header->width + x];
+    }
+
+    //////////////////////////////////////////
+    // loader thread: it prepares the requested chunks, until the terrain is destroyed
+    void loaderLoop()
+    {
+        unique_lock<mutex> lock(this->mtx);
+        while (true) {
+            this->requestCv.wait(lock, [this]{ return this->stopping || !this->requests.empty(); });
+            if (this->stopping)
+                return;
+            pair<GLint, GLint> key = this->requests.front();
+            this->requests.pop_front();
+
+            // the chunk is prepared without holding the lock
+            lock.unlock();
+            HeightfieldChunk* chunk = this->buildChunk(key.first, key.second);
+            lock.lock();
+
+            this->ready.push_back(chunk);
+            this->readyCv.notify_all();
+        }
+    }
+
+    //////////////////////////////////////////
+    // we read the samples of the chunk from the mapped file, and we build the data for its mesh and its Collision Shape
+    HeightfieldChunk* buildChunk(GLint cx, GLint cz)
+    {
+        HeightfieldChunk* chunk = new HeightfieldChunk();
+        const GLfloat cell = this->header->cellSize;
+        GLint x0 = cx * CHUNK_CELLS;
+        GLint z0 = cz * CHUNK_CELLS;
+        chunk->cx = cx;
+        chunk->cz = cz;
+        chunk->samplesX = glm::min(CHUNK_CELLS, (GLint)this->header->width - 1 - x0) + 1;
+        chunk->samplesZ = glm::min(CHUNK_CELLS, (GLint)this->header->height - 1 - z0) + 1;
+        chunk->origin = glm::vec3(this->firstSampleX() + x0 * cell, 0.0f, this->firstSampleZ() + z0 * cell);
+        chunk->materialData = this->materialData + z0 * this->header->width + x0;
+        chunk->stride = this->header->width;
+        chunk->materials = &this->materials;
+
+        // heights
+        chunk->heights.resize(chunk->samplesX * chunk->samplesZ);
+        chunk->minHeight = FLT_MAX;
+        chunk->maxHeight = -FLT_MAX;
+        for (GLuint z = 0; z < chunk->samplesZ; z++) {
+            for (GLuint x = 0; x < chunk->samplesX; x++) {
+                GLfloat h = this->sample(x0 + x, z0 + z);
+                chunk->heights[z * chunk->samplesX + x] = h;
+                chunk->minHeight = glm::min(chunk->minHeight, h);
+                chunk->maxHeight = glm::max(chunk->maxHeight, h);
+            }
+        }
+
+        // vertices (in chunk coordinates), with normals computed from the neighbour samples (also outside the chunk, so there are no seams)
+        chunk->vertices.resize(chunk->heights.size());
+        for (GLuint z = 0; z < chunk->samplesZ; z++) {
+            for (GLuint x = 0; x < chunk->samplesX; x++) {
+                GLint gx = x0 + x, gz = z0 + z;
+                Vertex& vertex = chunk->vertices[z * chunk->samplesX + x];
+                vertex.Position = glm::vec3(x * cell, chunk->heights[z * chunk->samplesX + x], z * cell);
+                GLfloat dx = this->sample(gx + 1, gz) - this->sample(gx - 1, gz);
+                GLfloat dz = this->sample(gx, gz + 1) - this->sample(gx, gz - 1);
+                vertex.Normal = glm::normalize(glm::vec3(-dx, 2.0f * cell, -dz));
+                // the texture is repeated every 40 meters, as on the tiles of the track
+                vertex.TexCoords = glm::vec2(chunk->origin.x + vertex.Position.x, chunk->origin.z + vertex.Position.z) / 40.0f;
+                vertex.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+                vertex.Bitangent = glm::vec3(0.0f, 0.0f, 1.0f);
+            }
+        }
+
+        // two triangles for each cell, counter-clockwise when seen from above (same diagonal used by btHeightfieldTerrainShape)
+        chunk->indices.reserve((chunk->samplesX - 1) * (chunk->samplesZ - 1) * 6);
+        for (GLuint z = 0; z + 1 < chunk->samplesZ; z++) {
+            for (GLuint x = 0; x + 1 < chunk->samplesX; x++) {
+                GLuint a = z * chunk->samplesX + x;
+                GLuint b = a + 1;
+                GLuint c = a + chunk->samplesX;
+                GLuint d = c + 1;
+                chunk->indices.push_back(a);
+                chunk->indices.push_back(c);
+                chunk->indices.push_back(b);
+                chunk->indices.push_back(b);
+                chunk->indices.push_back(c);
+                chunk->indices.push_back(d);
+            }
+        }
+        return chunk;
+    }
+
+    //////////////////////////////////////////
+    // the chunk is added to the scene: mesh in the shared buffers, and static rigid body
+    void addChunk(HeightfieldChunk* chunk)
+    {
+        chunk->mesh = new Mesh(std::move(chunk->vertices), std::move(chunk->indices), this->textures);
+
+        const GLfloat cell = this->header->cellSize;
+        btHeightfieldTerrainShape* shape = new btHeightfieldTerrainShape(chunk->samplesX, chunk->samplesZ, &chunk->heights[0], 1.0f, chunk->minHeight, chunk->maxHeight, 1, PHY_FLOAT, false);
+        shape->setLocalScaling(btVector3(cell, 1.0f, cell));
+
+        // Bullet places the heightfield centered in the origin of the body
+        glm::vec3 center = chunk->origin + glm::vec3(0.5f * (chunk->samplesX - 1) * cell, 0.5f * (chunk->minHeight + chunk->maxHeight), 0.5f * (chunk->samplesZ - 1) * cell);
+        chunk->body = this->simulation.createStaticBody(shape, center, 1.0f, 1.0f, COLL_TERRAIN, COLL_EVERYTHING);
+        chunk->body->setCollisionFlags(chunk->body->getCollisionFlags() | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
+        chunk->body->setUserPointer((SurfaceMap*)chunk);
+        gContactAddedCallback = terrainContactCallback;
+    }
+
+    // the chunk is removed from the scene, and deleted
+    void destroyChunk(HeightfieldChunk* chunk)
+    {
+        if (chunk->mesh) {
+            chunk->mesh->Delete();
+            delete chunk->mesh;
+        }
+        if (chunk->body)
+            this->simulation.deleteRigidBody(chunk->body);
+        delete chunk;
+    }
+};
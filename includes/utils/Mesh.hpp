@@ -11,6 +11,10 @@ N.B. 1) in this version of the class, textures are loaded and applied
 
 N.B. 2) adaptation of https://github.com/JoeyDeVries/LearnOpenGL/blob/master/includes/learnopengl/mesh.h
 
+N.B. 3) a Mesh can contain several sub-meshes sharing the same set of textures (see Model class): they are stored in the same buffers, and rendered with a single glMultiDrawElementsBaseVertex call
+
+N.B. 4) the VBO, VAO and EBO are not owned by the Mesh: its data are stored in a range of the buffers shared by all the meshes (see GeometryArena class)
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2018/2019
@@ -34,18 +38,15 @@ using namespace std;
 // we use GLM data structures to write data in the VBO, VAO and EBO buffers
 #include <glm/glm.hpp>
 
-// data structure for vertices
-struct Vertex {
-    // vertex coordinates
-    glm::vec3 Position;
-    // Normal
-    glm::vec3 Normal;
-    // Texture coordinates
-    glm::vec2 TexCoords;
-    // Tangent
-    glm::vec3 Tangent;
-    // Bitangent
-    glm::vec3 Bitangent;
+// shared buffers for all the meshes (and definition of the Vertex data structure)
+#include <utils/Arena.hpp>
+
+// data structure for a sub-mesh inside a batched Mesh:
+// it starts at firstIndex inside the mesh indices, and its indices are relative to baseVertex inside the mesh vertices
+struct SubMesh {
+    GLsizei indexCount;
+    GLuint firstIndex;
+    GLint baseVertex;
 };
 
 // data structure for textures
@@ -59,24 +60,42 @@ struct Texture {
 class Mesh {
 public:
     // data structures for vertices, and indices of vertices (for faces)
+    // N.B.) they are empty after the creation of the OpenGL buffers, unless the Mesh has been created with keepData = true
     vector<Vertex> vertices;
     vector<GLuint> indices;
     // data structures for textures
     vector<Texture> textures;
+    // ranges of the sub-meshes merged in this Mesh
+    vector<SubMesh> submeshes;
 
-    // VAO
-    GLuint VAO;
+    //////////////////////////////////////////
+    // Constructor (single mesh)
+    // data are moved inside the Mesh (no copies): the caller must pass them using std::move, or a temporary
+    // if keepData is false, vertices and indices are released once copied on the GPU (e.g., set it to true if they are needed to build a collision shape)
+    Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> textures, bool keepData = false)
+    {
+        SubMesh submesh = { (GLsizei)indices.size(), 0, 0 };
+        this->submeshes.push_back(submesh);
+
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+
+        // initialization of OpenGL buffers
+        this->setupMesh(keepData);
+    }
 
     //////////////////////////////////////////
-    // Constructor
-    Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> textures)
+    // Constructor (batch of sub-meshes sharing the same textures)
+    Mesh(vector<Vertex> vertices, vector<GLuint> indices, vector<Texture> textures, vector<SubMesh> submeshes, bool keepData = false)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        this->submeshes = std::move(submeshes);
 
         // initialization of OpenGL buffers
-        this->setupMesh();
+        this->setupMesh(keepData);
     }
 
     //////////////////////////////////////////
@@ -111,12 +130,14 @@ public:
             glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
         }
 
-        // VAO is made "active"
-        glBindVertexArray(this->VAO);
+        // the shared VAO is made "active" (it is already bound if another Mesh has been rendered before)
+        GeometryArena::Static().Bind();
         // rendering of data in the VAO
-        glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-        // VAO is "detached"
-        glBindVertexArray(0);
+        // if the Mesh is a batch, all the sub-meshes are rendered with a single call
+        if (this->submeshes.size() == 1)
+            glDrawElementsBaseVertex(GL_TRIANGLES, this->drawCounts[0], GL_UNSIGNED_INT, this->drawOffsets[0], this->drawBaseVertices[0]);
+        else
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, &this->drawCounts[0], GL_UNSIGNED_INT, &this->drawOffsets[0], this->submeshes.size(), &this->drawBaseVertices[0]);
 
         // Always good practice to set everything back to defaults once configured.
         for (GLuint i = 0; i < this->textures.size(); i++)
@@ -128,57 +149,45 @@ public:
 
     //////////////////////////////////////////
 
-    // buffers are deallocated when application ends
+    // the ranges in the shared buffers are released when application ends
     void Delete()
     {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
+        GeometryArena::Static().Free(this->vertexRange, this->indexRange);
     }
 
 private:
-  // VBO and EBO
-  GLuint VBO, EBO;
+  // ranges of vertices and indices inside the shared buffers
+  ArenaRange vertexRange, indexRange;
+  // parameters of glMultiDrawElementsBaseVertex, built from the sub-meshes
+  vector<GLsizei> drawCounts;
+  vector<const GLvoid*> drawOffsets;
+  vector<GLint> drawBaseVertices;
 
   //////////////////////////////////////////
-  // buffer objects\arrays are initialized
+  // data are copied in the shared buffers
   // a brief description of their role and how they are binded can be found at:
   // https://learnopengl.com/#!Getting-started/Hello-Triangle
   // (in different parts of the page), or here:
   // http://www.informit.com/articles/article.aspx?p=1377833&seqNum=8
-  void setupMesh()
+  void setupMesh(bool keepData)
   {
-      // we create the buffers
-      glGenVertexArrays(1, &this->VAO);
-      glGenBuffers(1, &this->VBO);
-      glGenBuffers(1, &this->EBO);
-
-      // VAO is made "active"
-      glBindVertexArray(this->VAO);
-      // we copy data in the VBO - we must set the data dimension, and the pointer to the structure cointaining the data
-      glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-      glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
-      // we copy data in the EBO - we must set the data dimension, and the pointer to the structure cointaining the data
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-      glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
-
-      // we set in the VAO the pointers to the different vertex attributes (with the relative offsets inside the data structure)
-      // vertex positions
-      glEnableVertexAttribArray(0);
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-      // Normals
-      glEnableVertexAttribArray(1);
-      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
-      // Texture Coordinates
-      glEnableVertexAttribArray(2);
-      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
-      // Tangent
-      glEnableVertexAttribArray(3);
-      glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Tangent));
-      // Bitangent
-      glEnableVertexAttribArray(4);
-      glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Bitangent));
-
-      glBindVertexArray(0);
+      // we copy data in a range of the shared VBO and EBO
+      GeometryArena::Static().Allocate(this->vertices, this->indices, this->vertexRange, this->indexRange);
+
+      // the CPU copies are not needed anymore for rendering: we free their memory
+      if (!keepData)
+      {
+          vector<Vertex>().swap(this->vertices);
+          vector<GLuint>().swap(this->indices);
+      }
+
+      // we prepare the arrays needed to render all the sub-meshes with a single draw call
+      // (the ranges of the sub-meshes are moved to the position of the Mesh inside the shared buffers)
+      for (GLuint i = 0; i < this->submeshes.size(); i++)
+      {
+          this->drawCounts.push_back(this->submeshes[i].indexCount);
+          this->drawOffsets.push_back((const GLvoid*)((this->indexRange.start + this->submeshes[i].firstIndex) * sizeof(GLuint)));
+          this->drawBaseVertices.push_back(this->vertexRange.start + this->submeshes[i].baseVertex);
+      }
   }
 };
@@ -7,6 +7,10 @@ N.B. 1) in this version of the class, eventual textures defined in the model (ex
 
 N.B. 2) adaptation of https://github.com/JoeyDeVries/LearnOpenGL/blob/master/includes/learnopengl/model.h
 
+N.B. 3) meshes of the model sharing the same set of textures are merged in a single Mesh instance (batch), so they are rendered with one draw call
+
+N.B. 4) if MODEL_LOAD_STATS is defined before the inclusion of this file (the asset loading benchmark does it), the time spent in each stage of the loading is added to the LoadStats structure pointed by loadStats. Otherwise the timing code is not compiled, and the loading has no overhead
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2018/2019
@@ -26,6 +30,10 @@ using namespace std;
 #include <iostream>
 #include <map>
 #include <vector>
+#include <cfloat>
+#ifdef MODEL_LOAD_STATS
+#include <chrono>
+#endif
 
 // GL Includes
 #include <glad/glad.h> // Contains all the necessery OpenGL includes
@@ -47,6 +55,26 @@ using namespace std;
 // function used to load image data
 GLint TextureFromFile(const char* path, string directory);
 
+#ifdef MODEL_LOAD_STATS
+// timings (seconds) and sizes (bytes) of the stages of the loading
+struct LoadStats {
+    double import;          // Assimp import of the file
+    double convert;         // conversion of the Assimp meshes, and batching
+    double textures;        // loading of the material textures (decode + upload)
+    double textureDecode, textureUpload;
+    double upload;          // creation of the OpenGL buffers of the meshes
+    size_t textureFileBytes, texturePixelBytes;
+};
+// if not NULL, the loading functions add their timings to this structure
+LoadStats* loadStats = NULL;
+
+// current time in seconds, for the stage timings
+inline double loadClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
 
 /////////////////// MODEL class ///////////////////////
 class Model
@@ -58,12 +86,19 @@ public:
     vector<Mesh> meshes;
     // the folder on disk of the model (needed for the loading of textures, if model is provided of textures)
     string directory;
+    // axis-aligned bounding box of the model (in model coordinates), used for frustum culling
+    glm::vec3 boundsMin, boundsMax;
+    // if true, meshes keep a CPU copy of vertices and indices after the creation of the OpenGL buffers (e.g., to build collision shapes)
+    bool keepData;
 
     //////////////////////////////////////////
 
     // constructor
-    Model(const string& path)
+    Model(const string& path, bool keepData = false)
     {
+        this->keepData = keepData;
+        this->boundsMin = glm::vec3(FLT_MAX);
+        this->boundsMax = glm::vec3(-FLT_MAX);
         this->loadModel(path);
     }
 
@@ -86,9 +121,23 @@ public:
             this->meshes[i].Delete();
     }
 
+    // a copy would free the same ranges of the shared buffers twice: models cannot be copied
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
 
 private:
 
+    // data structure for the meshes being merged during loading, before the creation of the OpenGL buffers
+    struct MeshBatch {
+        vector<Vertex> vertices;
+        vector<GLuint> indices;
+        vector<Texture> textures;
+        vector<SubMesh> submeshes;
+    };
+    // batches being built during loading (one for each different set of textures)
+    vector<MeshBatch> batches;
+
     //////////////////////////////////////////
     // loading of the model using Assimp library. Nodes are processed to build a vector of Mesh class instances
     void loadModel(string path)
@@ -98,8 +147,15 @@ private:
         // Details on the different flags to use are available at: http://assimp.sourceforge.net/lib_html/postprocess_8h.html#a64795260b95f5a4b3f3dc1be4f52e410
         // VERY IMPORTANT: calculation of Tangents and Bitangents is possible only if the model has Texture Coordinates
         // If they are not present, the calculation is skipped (but no error is provided in the foillowing checks!)
+#ifdef MODEL_LOAD_STATS
+        double start = loadStats ? loadClock() : 0.0;
+#endif
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+#ifdef MODEL_LOAD_STATS
+        if (loadStats)
+            loadStats->import += loadClock() - start;
+#endif
 
         // check for errors (see comment above)
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
@@ -113,6 +169,20 @@ private:
 
         // we start the recursive processing of nodes in the Assimp data structure
         this->processNode(scene->mRootNode, scene);
+
+        // we create an instance of the Mesh class for each batch
+        // data are moved from the batch to the Mesh, and then from the temporary Mesh to the vector, without copies
+#ifdef MODEL_LOAD_STATS
+        start = loadStats ? loadClock() : 0.0;
+#endif
+        this->meshes.reserve(this->meshes.size() + this->batches.size());
+        for(GLuint i = 0; i < this->batches.size(); i++)
+            this->meshes.push_back(Mesh(std::move(this->batches[i].vertices), std::move(this->batches[i].indices), std::move(this->batches[i].textures), std::move(this->batches[i].submeshes), this->keepData));
+        this->batches.clear();
+#ifdef MODEL_LOAD_STATS
+        if (loadStats)
+            loadStats->upload += loadClock() - start;
+#endif
     }
 
     //////////////////////////////////////////
@@ -127,8 +197,8 @@ private:
             // "Scene" contains all the data. Class node is used only to point to one or more mesh inside the scene and to maintain informations on relations between nodes
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
             // we start processing of the Assimp mesh using processMesh method.
-            // the result (an istance of the Mesh class) is added to the vector
-            this->meshes.push_back(this->processMesh(mesh, scene));
+            // the result is added to the batch with the same textures
+            this->processMesh(mesh, scene);
         }
         // we then recursively process each of the children nodes
         for(GLuint i = 0; i < node->mNumChildren; i++)
@@ -141,16 +211,23 @@ private:
     //////////////////////////////////////////
 
     // Processing of the Assimp mesh in order to obtain an "OpenGL mesh"
-    // = we create and allocate the buffers used to send mesh data to the GPU
+    // = we convert the data, and we add them to the batch that will be used to create and allocate the buffers used to send mesh data to the GPU
     // In this case, we pass also aiScene instance, because we need to set the materials once loaded the textures
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    void processMesh(aiMesh* mesh, const aiScene* scene)
     {
+#ifdef MODEL_LOAD_STATS
+        double start = loadStats ? loadClock() : 0.0;
+#endif
       // data structures for vertices and indices of vertices (for faces)
         vector<Vertex> vertices;
         vector<GLuint> indices;
         // vector with all the model textures
         vector<Texture> textures;
 
+        // we know the final size of the vectors, so we avoid reallocations
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
+
         for(GLuint i = 0; i < mesh->mNumVertices; i++)
         {
             Vertex vertex;
@@ -162,6 +239,9 @@ private:
             vector.y = mesh->mVertices[i].y;
             vector.z = mesh->mVertices[i].z;
             vertex.Position = vector;
+            // we update the bounding box of the model
+            this->boundsMin = glm::min(this->boundsMin, vector);
+            this->boundsMax = glm::max(this->boundsMax, vector);
             // Normals
             vector.x = mesh->mNormals[i].x;
             vector.y = mesh->mNormals[i].y;
@@ -205,6 +285,9 @@ private:
                 indices.push_back(face.mIndices[j]);
         }
 
+#ifdef MODEL_LOAD_STATS
+        double texturesStart = loadStats ? loadClock() : 0.0;
+#endif
         // we process the materials defined in the model file
         if(mesh->mMaterialIndex >= 0)
         {
@@ -230,8 +313,66 @@ private:
             textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         }
 
-        // we return an instance of the Mesh class created using the vertices and faces data structures we have created above.
-        return Mesh(vertices, indices, textures);
+#ifdef MODEL_LOAD_STATS
+        double texturesEnd = loadStats ? loadClock() : 0.0;
+#endif
+
+        // we add the vertices and faces data structures we have created above to the batch with the same textures
+        this->batchMesh(std::move(vertices), std::move(indices), std::move(textures));
+#ifdef MODEL_LOAD_STATS
+        if (loadStats)
+        {
+            loadStats->textures += texturesEnd - texturesStart;
+            loadStats->convert += loadClock() - start - (texturesEnd - texturesStart);
+        }
+#endif
+    }
+
+    //////////////////////////////////////////
+
+    // we append the mesh data to the batch using the same textures (a new batch is created if not present)
+    // the indices are not changed: each sub-mesh is rendered using its own base vertex inside the batch
+    // (if the batch is new, data are moved inside it without copies)
+    void batchMesh(vector<Vertex>&& vertices, vector<GLuint>&& indices, vector<Texture>&& textures)
+    {
+        GLuint b;
+        for(b = 0; b < this->batches.size(); b++)
+        {
+            if(this->sameTextures(this->batches[b].textures, textures))
+                break;
+        }
+        if(b == this->batches.size())
+        {
+            this->batches.push_back(MeshBatch());
+            this->batches[b].textures = std::move(textures);
+        }
+
+        MeshBatch& batch = this->batches[b];
+        SubMesh submesh = { (GLsizei)indices.size(), (GLuint)batch.indices.size(), (GLint)batch.vertices.size() };
+        batch.submeshes.push_back(submesh);
+        if(batch.vertices.empty())
+        {
+            batch.vertices = std::move(vertices);
+            batch.indices = std::move(indices);
+        }
+        else
+        {
+            batch.vertices.insert(batch.vertices.end(), vertices.begin(), vertices.end());
+            batch.indices.insert(batch.indices.end(), indices.begin(), indices.end());
+        }
+    }
+
+    // two meshes can be merged if they use the same textures, with the same order and type
+    bool sameTextures(const vector<Texture>& a, const vector<Texture>& b)
+    {
+        if(a.size() != b.size())
+            return false;
+        for(GLuint i = 0; i < a.size(); i++)
+        {
+            if(a[i].id != b[i].id || a[i].type != b[i].type)
+                return false;
+        }
+        return true;
     }
 
     // Load (if not yet loaded) the textures defined in the model materials (if defined)
@@ -276,7 +417,13 @@ GLint TextureFromFile(const char* path, string directory)
     GLuint textureID;
     glGenTextures(1, &textureID);
     int width,height,channels;
+#ifdef MODEL_LOAD_STATS
+    double start = loadStats ? loadClock() : 0.0;
+#endif
     unsigned char* image = stbi_load(filename.c_str(), &width, &height, &channels, 0);
+#ifdef MODEL_LOAD_STATS
+    double decoded = loadStats ? loadClock() : 0.0;
+#endif
 
     // Assign texture to ID
     glBindTexture(GL_TEXTURE_2D, textureID);
@@ -294,6 +441,16 @@ GLint TextureFromFile(const char* path, string directory)
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
+#ifdef MODEL_LOAD_STATS
+    if (loadStats)
+    {
+        loadStats->textureDecode += decoded - start;
+        loadStats->textureUpload += loadClock() - decoded;
+        ifstream file(filename.c_str(), ios::binary | ios::ate);
+        loadStats->textureFileBytes += file ? (size_t)file.tellg() : 0;
+        loadStats->texturePixelBytes += image ? (size_t)width * height * channels : 0;
+    }
+#endif
     // we free the memory once we have created an OpenGL texture
     stbi_image_free(image);
     return textureID;
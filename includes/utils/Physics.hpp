@@ -6,6 +6,12 @@ The class sets up the collision manager and the resolver of the constraints, usi
 
 createRigidBody method sets up a  Box or Sphere Collision Shape. For other Shapes, you must extend the method.
 
+Rigid bodies, Motion States and constraints are allocated from pools owned by the simulation (see ObjectPool class), and the Box, Sphere and Cylinder shapes are shared between bodies with the same shape type and size (see ShapeRegistry class).
+Reset removes and deletes all the bodies, constraints and shapes, but it keeps the dynamics world, the collision manager and the solver, and the memory of the pools: successive scenarios can be run in the same simulation without allocating them again. Clear deletes everything, at the end of the program.
+Bullet can be compiled in double precision (BT_USE_DOUBLE_PRECISION: btScalar is a double), for large worlds: in single precision, the positions far from the origin lose the sub-millimetre precision needed by the suspension constraints. The conversions between glm (always in single precision) and Bullet are done with toBullet and toGlm, and the model matrices for rendering are computed relative to a render origin (camera-relative rendering, see renderMatrix), so the floats sent to the GPU are always small numbers.
+N.B. 1) all the bodies and constraints in the dynamics world must be created (and deleted) using the methods of this class
+N.B. 2) the objects owning bodies of the simulation (e.g., Vehicle, Terrain and HeightfieldTerrain classes) must be deleted before Reset and Clear
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2018/2019
@@ -17,8 +23,11 @@ Universita' degli Studi di Milano
 
 #include <btBulletDynamicsCommon.h>
 
-//enum to identify the 2 considered Collision Shapes
-enum shapes{ BOX, SPHERE, CYLINDER };
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <utils/Pool.hpp>
+#include <utils/ShapeRegistry.hpp>
 
 //enum to filter out collision checks
 enum collflag {
@@ -29,6 +38,28 @@ enum collflag {
     COLL_EVERYTHING = -1
 };
 
+//////////////////////////////////////////
+// conversions between glm and Bullet vectors (btScalar can be float or double)
+inline btVector3 toBullet(const glm::vec3& v)
+{
+    return btVector3(v.x, v.y, v.z);
+}
+
+inline glm::vec3 toGlm(const btVector3& v)
+{
+    return glm::vec3(v.x(), v.y(), v.z());
+}
+
+// model matrix of a Bullet transform, relative to the render origin (e.g., the position of the camera)
+// the difference of the positions is computed in btScalar, and only the result is converted to float
+inline glm::mat4 renderMatrix(const btTransform& transform, const btVector3& origin)
+{
+    btTransform relative(transform.getBasis(), transform.getOrigin() - origin);
+    btScalar matrix[16];
+    relative.getOpenGLMatrix(matrix);
+    return glm::mat4(glm::make_mat4(matrix));
+}
+
 ///////////////////  Physics class ///////////////////////
 class Physics
 {
@@ -40,6 +71,12 @@ public:
     btCollisionDispatcher* dispatcher; // collision manager
     btBroadphaseInterface* overlappingPairCache; // method for the broadphase collision detection
     btSequentialImpulseConstraintSolver* solver; // constraints solver
+    ShapeRegistry shapeRegistry; // shapes shared between bodies
+
+    // pools for the objects of the simulation
+    ObjectPool<btRigidBody> bodies;
+    ObjectPool<btDefaultMotionState> motionStates;
+    ObjectPool<btGeneric6DofSpringConstraint> constraints;
 
 
     //////////////////////////////////////////
@@ -74,34 +111,15 @@ public:
    btRigidBody* createRigidBody(int type, glm::vec3 pos, glm::vec3 size, glm::vec3 rot, float m, float friction , float restitution, short group, short mask)
     {
 
-        btCollisionShape* cShape = NULL;
-
         // we convert the glm vector to a Bullet vector
-        btVector3 position = btVector3(pos.x,pos.y,pos.z);
+        btVector3 position = toBullet(pos);
 
         // we set a quaternion from the Euler angles passed as parameters
         btQuaternion rotation;
         rotation.setEuler(rot.x,rot.y,rot.z);
 
-        // Box Collision shape
-        if (type == BOX)
-        {
-            // we convert the glm vector to a Bullet vector
-            btVector3 dim = btVector3(size.x,size.y,size.z);
-            // BoxShape
-            cShape = new btBoxShape(dim);
-        }
-        // Sphere Collision Shape (in this case we consider only the first component)
-        else if (type == SPHERE)
-        {
-            cShape = new btSphereShape(size.x);
-        } else if (type == CYLINDER) {
-            btVector3 dim = btVector3(size.x,size.y,size.z);
-            cShape = new btCylinderShape(dim);
-        }
-
-        // we add this Collision Shape to the vector
-        this->collisionShapes.push_back(cShape);
+        // the Collision Shape is shared with the other bodies with the same type and size
+        btCollisionShape* cShape = this->getShape(type, size);
 
         // We set the initial transformations
         btTransform objTransform;
@@ -121,7 +139,7 @@ public:
 
         // we initialize the Motion State of the object on the basis of the transformations
         // Using the Motion State, the physical simulation will calculate the positions and rotations of the rigid body
-        btDefaultMotionState* motionState = new btDefaultMotionState(objTransform);
+        btDefaultMotionState* motionState = this->motionStates.New(objTransform);
 
         // we set the data structure for the rigid body
         btRigidBody::btRigidBodyConstructionInfo rbInfo(mass,motionState,cShape,localInertia);
@@ -141,7 +159,7 @@ public:
         }
 
         // we create the rigid body
-        btRigidBody* body = new btRigidBody(rbInfo);
+        btRigidBody* body = this->bodies.New(rbInfo);
 
         //add the body to the dynamics world
         this->dynamicsWorld->addRigidBody(body, group, mask);
@@ -152,9 +170,96 @@ public:
     }
 
     //////////////////////////////////////////
-    // We delete the data of the physical simulation when the program ends
-    void Clear()
+    // Method for the creation of a static rigid body, based on a Collision Shape created by the caller (e.g., a Compound Shape)
+    // The shape is added to the vector, so it is deleted by the Clear method (the children of a Compound Shape must be added using addCollisionShape)
+    btRigidBody* createStaticBody(btCollisionShape* cShape, glm::vec3 pos, float friction, float restitution, short group, short mask)
     {
+        this->addCollisionShape(cShape);
+
+        btTransform objTransform;
+        objTransform.setIdentity();
+        objTransform.setOrigin(toBullet(pos));
+
+        // static object: mass = 0, no inertia
+        btDefaultMotionState* motionState = this->motionStates.New(objTransform);
+        btRigidBody::btRigidBodyConstructionInfo rbInfo(0.0f,motionState,cShape,btVector3(0.0f,0.0f,0.0f));
+        rbInfo.m_friction = friction;
+        rbInfo.m_restitution = restitution;
+
+        btRigidBody* body = this->bodies.New(rbInfo);
+        this->dynamicsWorld->addRigidBody(body, group, mask);
+        return body;
+    }
+
+    //////////////////////////////////////////
+    // we remove a rigid body from the simulation, and we delete it together with its Motion State and its Collision Shape
+    // (used for objects removed during the simulation, e.g. streamed terrain chunks)
+    // N.B.) shared shapes are deleted only when no other body uses them
+    void deleteRigidBody(btRigidBody* body)
+    {
+        btCollisionShape* cShape = body->getCollisionShape();
+        this->dynamicsWorld->removeRigidBody(body);
+        this->motionStates.Delete((btDefaultMotionState*)body->getMotionState());
+        this->bodies.Delete(body);
+
+        // the children of a Compound Shape are released too (e.g., the shared boxes of the Terrain class)
+        if (cShape->isCompound()) {
+            btCompoundShape* compound = (btCompoundShape*)cShape;
+            for (int i = compound->getNumChildShapes() - 1; i >= 0; i--)
+                this->releaseShape(compound->getChildShape(i));
+        }
+        this->releaseShape(cShape);
+    }
+
+    // we release a Collision Shape: shared shapes are deleted when no other body uses them, the other ones are removed from the vector and deleted
+    void releaseShape(btCollisionShape* cShape)
+    {
+        if (!this->shapeRegistry.Release(cShape)) {
+            this->collisionShapes.remove(cShape);
+            delete cShape;
+        }
+    }
+
+    //////////////////////////////////////////
+    // we add a Collision Shape to the vector, so it is deleted at the end
+    void addCollisionShape(btCollisionShape* cShape)
+    {
+        this->collisionShapes.push_back(cShape);
+    }
+
+    //////////////////////////////////////////
+    // shared Collision Shape with the given type and size, with a new reference (released when the body using it is deleted)
+    btCollisionShape* getShape(int type, glm::vec3 size)
+    {
+        return this->shapeRegistry.Acquire(type, size);
+    }
+
+    //////////////////////////////////////////
+    // we create a spring constraint between two bodies, allocated from the pool of the simulation (the caller adds it to the dynamics world with addConstraint)
+    btGeneric6DofSpringConstraint* createSpringConstraint(btRigidBody& bodyA, btRigidBody& bodyB, const btTransform& frameA, const btTransform& frameB)
+    {
+        btGeneric6DofSpringConstraint* c = this->constraints.New(bodyA, bodyB, frameA, frameB, true);
+        return c;
+    }
+
+    // we remove a constraint from the simulation, and we delete it
+    void deleteConstraint(btGeneric6DofSpringConstraint* c)
+    {
+        this->dynamicsWorld->removeConstraint(c);
+        this->constraints.Delete(c);
+    }
+
+    //////////////////////////////////////////
+    // We delete all the bodies, constraints and shapes of the simulation, and we bring the simulation back to the initial state
+    // the dynamics world, the collision manager, the broadphase and the solver are kept, and the deleted objects go back to the pools
+    void Reset()
+    {
+        //we remove the constraints from the dynamics world and delete them
+        for (int i=this->dynamicsWorld->getNumConstraints()-1; i>=0 ;i--)
+        {
+            this->deleteConstraint((btGeneric6DofSpringConstraint*)this->dynamicsWorld->getConstraint(i));
+        }
+
         //we remove the rigid bodies from the dynamics world and delete them
         for (int i=this->dynamicsWorld->getNumCollisionObjects()-1; i>=0 ;i--)
         {
@@ -164,10 +269,10 @@ public:
             btRigidBody* body = btRigidBody::upcast(obj);
             if (body && body->getMotionState())
             {
-                delete body->getMotionState();
+                this->motionStates.Delete((btDefaultMotionState*)body->getMotionState());
             }
             this->dynamicsWorld->removeCollisionObject( obj );
-            delete obj;
+            this->bodies.Delete(body);
         }
 
         // we remove all the Collision Shapes
@@ -177,6 +282,19 @@ public:
             this->collisionShapes[j] = 0;
             delete shape;
         }
+        this->collisionShapes.clear();
+        this->shapeRegistry.Clear();
+
+        // the broadphase has no proxies left: we clear its pair cache, and the random seed of the solver
+        ((btDbvtBroadphase*)this->overlappingPairCache)->resetPool(this->dispatcher);
+        this->solver->reset();
+    }
+
+    //////////////////////////////////////////
+    // We delete the data of the physical simulation when the program ends
+    void Clear()
+    {
+        this->Reset();
 
         //delete dynamics world
         delete this->dynamicsWorld;
@@ -192,6 +310,9 @@ public:
 
         delete this->collisionConfiguration;
 
-        this->collisionShapes.clear();
+        // the memory of the pools is released
+        this->bodies.Release();
+        this->motionStates.Release();
+        this->constraints.Release();
     }
 };
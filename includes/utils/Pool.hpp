@@ -0,0 +1,98 @@
+/*
+ObjectPool class - v1
+- typed pool of objects of the physics simulation (rigid bodies, motion states, constraints), owned by the Physics class
+- objects are constructed in fixed-size chunks of slots, and the slots of the deleted objects are reused
+
+Spawning and removing objects (e.g., streamed terrain chunks, traffic vehicles) does not call the general purpose allocator for each object: a new chunk is allocated only when all the slots are in use, and the memory is released only by Release.
+The slots of a chunk are handed out in order, so the objects created together (e.g., the bodies of a vehicle) are contiguous in memory, which helps the cache during the constraint solving.
+
+N.B. 1) the slots are aligned to 16 bytes, as required by the Bullet classes with SIMD members
+N.B. 2) Release frees the memory of the chunks without destroying the objects: all the objects must be deleted before
+*/
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <new>
+
+#include <LinearMath/btAlignedAllocator.h>
+
+///////////////////  ObjectPool class ///////////////////////
+template <typename T, unsigned int CHUNK = 64>
+class ObjectPool
+{
+public:
+    // number of objects currently in use
+    unsigned int live;
+
+    ObjectPool()
+    {
+        this->freeList = NULL;
+        this->live = 0;
+    }
+
+    ~ObjectPool()
+    {
+        this->Release();
+    }
+
+    //////////////////////////////////////////
+    // we construct an object in a free slot (a new chunk is allocated if there are no free slots)
+    template <typename... Args>
+    T* New(Args&&... args)
+    {
+        if (!this->freeList)
+            this->grow();
+        Slot* slot = this->freeList;
+        this->freeList = slot->next;
+        this->live++;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    // we destroy the object, and its slot goes back to the free list
+    void Delete(T* object)
+    {
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = this->freeList;
+        this->freeList = slot;
+        this->live--;
+    }
+
+    //////////////////////////////////////////
+    // we free the memory of all the chunks
+    void Release()
+    {
+        for (unsigned int i = 0; i < this->chunks.size(); i++)
+            btAlignedFree(this->chunks[i]);
+        this->chunks.clear();
+        this->freeList = NULL;
+        this->live = 0;
+    }
+
+private:
+    // a slot contains an object, or the pointer to the next free slot
+    union Slot {
+        Slot* next;
+        alignas(16) unsigned char storage[sizeof(T)];
+    };
+
+    std::vector<Slot*> chunks;
+    Slot* freeList;
+
+    //////////////////////////////////////////
+    // we allocate a new chunk, and we add its slots to the free list (the first slot of the chunk is the first one to be used)
+    void grow()
+    {
+        Slot* chunk = (Slot*)btAlignedAlloc(sizeof(Slot) * CHUNK, 16);
+        this->chunks.push_back(chunk);
+        for (int i = CHUNK - 1; i >= 0; i--) {
+            chunk[i].next = this->freeList;
+            this->freeList = &chunk[i];
+        }
+    }
+
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator=(const ObjectPool&);
+};
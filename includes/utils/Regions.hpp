@@ -0,0 +1,178 @@
+/*
+Region and RegionExecutor classes - v1
+- a region is an independent sub-world: its own Physics simulation, vehicles and tyre model
+- the executor steps all the regions in parallel on a work-stealing thread pool (see ThreadPool class), once for each frame
+
+Vehicles far apart never interact, but a single btDiscreteDynamicsWorld runs collision detection, solver and integration of all its islands on one thread, and its data (broadphase, manifolds, islands) cannot be shared between threads. So the scaling path for large open tracks, or for many scenarios run at the same time, is to split the scene in regions, each one with its own dynamics world: each region is stepped by a single thread, and no data is shared between regions, so no locks are needed during the step.
+
+The result does not depend on the number of threads, nor on the order in which the regions are run: each region is stepped with the same fixed time step, and it depends only on its own data. After the step (the barrier of the thread pool), the statistics of the regions are merged on the calling thread, always in the order of the regions.
+
+N.B. 1) each region must have its own static geometry (e.g., a Terrain created with the simulation of the region), and its vehicles must not leave it
+N.B. 2) Bullet 2.83 is not thread-safe, even between separate worlds: some global variables are written during a step
+    - the profiling data (CProfileManager): Bullet and the application must be compiled with -DBT_NO_PROFILE, otherwise the threads corrupt the profile tree
+    - statistics counters, incremented without synchronization: gNumAlignedAllocs, gNumAlignedFree (btAlignedAllocInternal, btAlignedFreeInternal), gNumManifold (getNewManifold, releaseManifold), gOverlappingPairs, gAddedPairs, gRemovePairs, gFindPairs (btHashedOverlappingPairCache), gNumGjkChecks, gNumDeepPenetrationChecks (btGjkPairDetector), gNumSplitImpulseRecoveries, gNumClampedCcdMotions
+   The counters are never read by the simulation or by the application: parallel regions only make their values wrong. They are still data races, so they are listed in tests/tsan-bullet.supp, and tests/regions.cpp checks under ThreadSanitizer that there are no other races. The global callbacks and settings (e.g., gContactAddedCallback, gDisableDeactivation) are only read during a step: they must be set before the regions are stepped, and so must be created the bodies and constraints (e.g., the single-body constraints share a static fixed body)
+N.B. 3) like the Physics class, a region deletes its bodies when it is deleted: the owners of the bodies (vehicles, terrain) must be deleted before
+N.B. 4) the parallel step is disabled until tests/regions.cpp has passed under ThreadSanitizer with a Bullet built with -fsanitize=thread: by default the executor has no workers, and all the regions are stepped on the calling thread (same results, no races). Compile with -DREGIONS_PARALLEL to enable the workers (the regions test and the benchmark do)
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <utils/Physics.hpp>
+#include <utils/Vehicle.hpp>
+#include <utils/TyreModel.hpp>
+#include <utils/ThreadPool.hpp>
+
+// systems of the vehicles of a region (see below)
+void regionTick(btDynamicsWorld* world, btScalar timeStep);
+
+///////////////////  Region class ///////////////////////
+class Region
+{
+public:
+    // the dynamics world of the region
+    Physics simulation;
+    // the vehicles of the region, updated at each tick
+    vector<Vehicle*> vehicles;
+    TyreModel tyreModel;
+    // statistics of the last step: internal ticks, awake vehicles, time spent in the step (s)
+    int ticks;
+    GLuint awake;
+    double stepTime;
+
+    //////////////////////////////////////////
+    // constructor: the systems of the vehicles are updated at each tick of the world of the region
+    Region()
+    {
+        this->ticks = 0;
+        this->awake = 0;
+        this->stepTime = 0.0;
+        this->simulation.dynamicsWorld->setInternalTickCallback(regionTick, this, true);
+    }
+
+    // destructor: we delete the vehicles, and the simulation
+    ~Region()
+    {
+        for (GLuint i = 0; i < this->vehicles.size(); i++)
+            delete this->vehicles[i];
+        this->simulation.Clear();
+    }
+
+    //////////////////////////////////////////
+    // we create a vehicle in the region (it is deleted by the region)
+    Vehicle* AddVehicle(glm::vec3 spawn, GLfloat chassisMass, GLfloat frontTyreMass, GLfloat rearTyreMass, GLfloat tyreFriction, GLfloat stiffness, GLfloat damping, GLfloat lowLim, GLfloat upLim)
+    {
+        Vehicle* vehicle = new Vehicle(this->simulation, spawn, chassisMass, frontTyreMass, rearTyreMass, tyreFriction, stiffness, damping, lowLim, upLim);
+        this->vehicles.push_back(vehicle);
+        return vehicle;
+    }
+
+    //////////////////////////////////////////
+    // we step the world of the region (called by a thread of the pool)
+    void Step(btScalar deltaTime, int maxSubSteps, btScalar fixedTimeStep)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        this->ticks = this->simulation.dynamicsWorld->stepSimulation(deltaTime, maxSubSteps, fixedTimeStep);
+        this->awake = 0;
+        for (GLuint i = 0; i < this->vehicles.size(); i++)
+            this->awake += !this->vehicles[i]->Sleeping();
+        this->stepTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+};
+
+//////////////////////////////////////////
+// the systems of the vehicles, like in the application (see physicsTick in src/App.cpp)
+void regionTick(btDynamicsWorld* world, btScalar timeStep)
+{
+    Region* region = (Region*)world->getWorldUserInfo();
+    vector<Vehicle*>& vehicles = region->vehicles;
+    for (GLuint i = 0; i < vehicles.size(); i++)
+        vehicles[i]->ApplyControls(timeStep);
+    for (GLuint i = 0; i < vehicles.size(); i++)
+        vehicles[i]->UpdateDrivetrain(timeStep);
+    for (GLuint i = 0; i < vehicles.size(); i++)
+        vehicles[i]->UpdateAerodynamics(timeStep);
+    region->tyreModel.Update(vehicles, world, timeStep);
+}
+
+///////////////////  RegionExecutor class ///////////////////////
+class RegionExecutor
+{
+public:
+    vector<Region*> regions;
+    // statistics of the last step, merged in the order of the regions
+    int ticks;
+    GLuint awake;
+    double stepTime;        // sum of the step times of the regions (s)
+    double slowestRegion;   // longest step of a region (s): lower bound of the time of a parallel step
+
+    //////////////////////////////////////////
+    // constructor: a pool with the given number of workers, besides the calling thread (by default, one for each hardware thread); without REGIONS_PARALLEL, no workers (see N.B. 4)
+    RegionExecutor(int workers = -1)
+#ifdef REGIONS_PARALLEL
+        : pool(workers)
+#else
+        : pool(0)
+#endif
+    {
+        this->ticks = 0;
+        this->awake = 0;
+        this->stepTime = 0.0;
+        this->slowestRegion = 0.0;
+    }
+
+    // destructor: we delete the regions (with their vehicles)
+    ~RegionExecutor()
+    {
+        for (GLuint i = 0; i < this->regions.size(); i++)
+            delete this->regions[i];
+    }
+
+    //////////////////////////////////////////
+    // we add a new empty region
+    Region* AddRegion()
+    {
+        Region* region = new Region();
+        this->regions.push_back(region);
+        return region;
+    }
+
+    // number of threads stepping the regions
+    unsigned int Threads() const
+    {
+        return this->pool.Size();
+    }
+
+    //////////////////////////////////////////
+    // we step all the regions in parallel, and we merge their statistics
+    void Step(btScalar deltaTime, int maxSubSteps = 1, btScalar fixedTimeStep = btScalar(1.) / btScalar(60.))
+    {
+        for (GLuint i = 0; i < this->regions.size(); i++) {
+            Region* region = this->regions[i];
+            this->pool.Submit([region, deltaTime, maxSubSteps, fixedTimeStep] { region->Step(deltaTime, maxSubSteps, fixedTimeStep); });
+        }
+        this->pool.Wait();
+
+        this->ticks = 0;
+        this->awake = 0;
+        this->stepTime = 0.0;
+        this->slowestRegion = 0.0;
+        for (GLuint i = 0; i < this->regions.size(); i++) {
+            this->ticks = glm::max(this->ticks, this->regions[i]->ticks);
+            this->awake += this->regions[i]->awake;
+            this->stepTime += this->regions[i]->stepTime;
+            this->slowestRegion = glm::max(this->slowestRegion, this->regions[i]->stepTime);
+        }
+    }
+
+private:
+    ThreadPool pool;
+};
@@ -3,7 +3,11 @@ Shader class - v1
 - loading Shader source code, Shader Program creation
 implementazione classe per caricamento codice shader e creazione Program Shader
 
-N.B. ) adaptation of https://github.com/JoeyDeVries/LearnOpenGL/blob/master/includes/learnopengl/shader.h
+The linked programs are cached on disk (see shaderCacheFolder): at the first start, the binary of each program is retrieved with glGetProgramBinary and saved in a file; at the next starts, the program is loaded with glProgramBinary, and the compilation and linking of the GLSL sources (a noticeable stall at startup, e.g., on Mesa llvmpipe) are skipped. The file of a program is named after the paths of its sources, and it contains a key: the hash of the sources and of the vendor/renderer/version strings of the driver. If the key does not match (the sources were changed, or the driver was updated), or if the driver rejects the binary, the program is compiled from the sources as before, and the file is overwritten.
+
+N.B. 1) the cache requires GL_ARB_get_program_binary (core in OpenGL 4.1), and at least one binary format: otherwise, the programs are always compiled
+N.B. 2) the binaries are not portable between drivers or GPUs: the cache folder must not be shared between machines
+N.B. 3) adaptation of https://github.com/JoeyDeVries/LearnOpenGL/blob/master/includes/learnopengl/shader.h
 
 author: Davide Gadia
 
@@ -21,15 +25,27 @@ using namespace std;
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstdint>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 
 // GL Includes
 #include <glad/glad.h> // Contains all the necessery OpenGL includes
 
+// folder of the cached program binaries (NULL to disable the cache)
+const char* shaderCacheFolder = "shaders/cache";
+
 /////////////////// SHADER class ///////////////////////
 class Shader
 {
 public:
     GLuint Program;
+    // true if the program has been loaded from the cache, false if it has been compiled
+    bool FromCache;
 
     //////////////////////////////////////////
 
@@ -66,6 +82,17 @@ public:
             cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
         }
 
+        // we try to load the program from the cache
+        this->FromCache = false;
+        string cachePath;
+        uint64_t key = 0;
+        if (cacheAvailable()) {
+            cachePath = string(shaderCacheFolder) + "/" + hexHash(fnv1a(string(vertexPath) + "|" + fragmentPath)) + ".bin";
+            key = cacheKey(vertexCode, fragmentCode);
+            if (loadBinary(cachePath, key))
+                return;
+        }
+
         // converto le stringhe in puntatori a char
         const GLchar* vShaderCode = vertexCode.c_str();
         const GLchar * fShaderCode = fragmentCode.c_str();
@@ -91,6 +118,9 @@ public:
         this->Program = glCreateProgram();
         glAttachShader(this->Program, vertex);
         glAttachShader(this->Program, fragment);
+        // the binary of the program will be retrieved after linking
+        if (!cachePath.empty())
+            glProgramParameteri(this->Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(this->Program);
         // check linking errors
         checkCompileErrors(this->Program, "PROGRAM");
@@ -98,6 +128,10 @@ public:
         // Step 4: we delete the shaders because they are linked to the Shader Program, and we do not need them anymore
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+
+        // Step 5: we save the binary of the program in the cache
+        if (!cachePath.empty())
+            saveBinary(cachePath, key);
     }
 
     //////////////////////////////////////////
@@ -146,6 +180,110 @@ public:
         glUniformMatrix4fv(glGetUniformLocation(Program, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
 
 private:
+    // header of a file of the cache: it is followed by the binary of the program
+    struct CacheHeader
+    {
+        GLuint magic;       // "GLPB"
+        uint64_t key;       // hash of the sources and of the driver
+        GLenum format;      // binary format of the driver
+        GLint length;       // size of the binary in bytes
+    };
+    static const GLuint CACHE_MAGIC = 0x42504C47;
+
+    //////////////////////////////////////////
+    // the cache can be used if it is enabled, and if the driver supports at least one binary format
+    static bool cacheAvailable()
+    {
+        if (shaderCacheFolder == NULL || !GLAD_GL_ARB_get_program_binary)
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    // 64 bit FNV-1a hash of a string
+    static uint64_t fnv1a(const string& data, uint64_t hash = 14695981039346656037ULL)
+    {
+        for (size_t i = 0; i < data.size(); i++) {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static string hexHash(uint64_t hash)
+    {
+        stringstream stream;
+        stream << hex << hash;
+        return stream.str();
+    }
+
+    // key of a program: the sources, and the driver which produced the binary
+    static uint64_t cacheKey(const string& vertexCode, const string& fragmentCode)
+    {
+        const char* strings[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+        uint64_t hash = fnv1a(vertexCode);
+        hash = fnv1a(string(1, '\0') + fragmentCode, hash);
+        for (int i = 0; i < 3; i++)
+            hash = fnv1a(string(1, '\0') + (strings[i] ? strings[i] : ""), hash);
+        return hash;
+    }
+
+    //////////////////////////////////////////
+    // we load the program from the file of the cache: false if the file is missing, if the key does not match, or if the driver rejects the binary
+    bool loadBinary(const string& path, uint64_t key)
+    {
+        ifstream file(path.c_str(), ios::binary);
+        CacheHeader header;
+        if (!file.read((char*)&header, sizeof(header)) || header.magic != CACHE_MAGIC || header.key != key || header.length <= 0)
+            return false;
+        vector<char> binary(header.length);
+        if (!file.read(binary.data(), header.length))
+            return false;
+
+        this->Program = glCreateProgram();
+        glProgramBinary(this->Program, header.format, binary.data(), header.length);
+        GLint success;
+        glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // e.g., the format is no longer supported: the program will be compiled
+            glDeleteProgram(this->Program);
+            while (glGetError() != GL_NO_ERROR);
+            return false;
+        }
+        this->FromCache = true;
+        return true;
+    }
+
+    // we save the binary of the linked program in the file of the cache
+    void saveBinary(const string& path, uint64_t key)
+    {
+        CacheHeader header;
+        header.magic = CACHE_MAGIC;
+        header.key = key;
+        header.length = 0;
+        GLint success;
+        glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+        glGetProgramiv(this->Program, GL_PROGRAM_BINARY_LENGTH, &header.length);
+        if (!success || header.length <= 0)
+            return;
+        vector<char> binary(header.length);
+        glGetProgramBinary(this->Program, header.length, &header.length, &header.format, binary.data());
+        if (header.length <= 0)
+            return;
+
+#ifdef _WIN32
+        _mkdir(shaderCacheFolder);
+#else
+        mkdir(shaderCacheFolder, 0755);
+#endif
+        ofstream file(path.c_str(), ios::binary | ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), header.length);
+        if (!file)
+            cout << "WARNING::SHADER::CACHE_NOT_WRITTEN: " << path << endl;
+    }
+
     //////////////////////////////////////////
 
     // Check compilation and linking errors
@@ -0,0 +1,119 @@
+/*
+ShapeRegistry class - v1
+- registry of the Collision Shapes shared between bodies, keyed by shape type and size
+- reference counting: a shape is deleted when the last body (or compound child) using it is removed
+
+Bodies with the same shape type and size (e.g., the chassis and the wheels of all the vehicles, or the tiles of the terrain with the same size) share a single Collision Shape: Bullet shapes are immutable data, and the position of each body is in its own transform. With hundreds of vehicles, the memory for the shapes does not grow with the number of vehicles, and the narrowphase reads the same few shapes for all the contacts.
+
+Acquire returns the shape for the key (created at the first request) and adds a reference; Release removes a reference, and deletes the shape when it is not used anymore. Clear deletes all the shapes, whatever their references (when the whole simulation is deleted).
+
+N.B.) the size is compared exactly: shapes with almost equal sizes are different shapes
+*/
+
+#pragma once
+
+#include <map>
+
+#include <btBulletDynamicsCommon.h>
+#include <glm/glm.hpp>
+
+//enum to identify the considered Collision Shapes
+enum shapes{ BOX, SPHERE, CYLINDER };
+
+///////////////////  ShapeRegistry class ///////////////////////
+class ShapeRegistry
+{
+public:
+    ~ShapeRegistry()
+    {
+        this->Clear();
+    }
+
+    //////////////////////////////////////////
+    // shared shape with the given type and size, with a new reference
+    btCollisionShape* Acquire(int type, glm::vec3 size)
+    {
+        ShapeKey key = { type, size.x, size.y, size.z };
+        std::map<ShapeKey, Entry>::iterator it = this->entries.find(key);
+        if (it != this->entries.end()) {
+            it->second.references++;
+            return it->second.shape;
+        }
+
+        btCollisionShape* cShape = NULL;
+        // we convert the glm vector to a Bullet vector
+        btVector3 dim = btVector3(size.x,size.y,size.z);
+        // Box Collision shape
+        if (type == BOX)
+            cShape = new btBoxShape(dim);
+        // Sphere Collision Shape (in this case we consider only the first component)
+        else if (type == SPHERE)
+            cShape = new btSphereShape(size.x);
+        else if (type == CYLINDER)
+            cShape = new btCylinderShape(dim);
+
+        Entry entry = { cShape, 1 };
+        this->entries[key] = entry;
+        this->keys[cShape] = key;
+        return cShape;
+    }
+
+    //////////////////////////////////////////
+    // we remove a reference to the shape (false if the shape is not in the registry)
+    bool Release(btCollisionShape* cShape)
+    {
+        std::map<btCollisionShape*, ShapeKey>::iterator key = this->keys.find(cShape);
+        if (key == this->keys.end())
+            return false;
+        std::map<ShapeKey, Entry>::iterator it = this->entries.find(key->second);
+        if (--it->second.references == 0) {
+            delete cShape;
+            this->entries.erase(it);
+            this->keys.erase(key);
+        }
+        return true;
+    }
+
+    // true if the shape is in the registry
+    bool Contains(btCollisionShape* cShape) const
+    {
+        return this->keys.count(cShape) > 0;
+    }
+
+    // number of shapes in the registry
+    unsigned int Count() const
+    {
+        return this->entries.size();
+    }
+
+    //////////////////////////////////////////
+    // we delete all the shapes
+    void Clear()
+    {
+        for (std::map<ShapeKey, Entry>::iterator it = this->entries.begin(); it != this->entries.end(); it++)
+            delete it->second.shape;
+        this->entries.clear();
+        this->keys.clear();
+    }
+
+private:
+    // key of the shapes: type and size
+    struct ShapeKey {
+        int type;
+        float x, y, z;
+        bool operator<(const ShapeKey& other) const
+        {
+            if (this->type != other.type) return this->type < other.type;
+            if (this->x != other.x) return this->x < other.x;
+            if (this->y != other.y) return this->y < other.y;
+            return this->z < other.z;
+        }
+    };
+    struct Entry {
+        btCollisionShape* shape;
+        unsigned int references;
+    };
+
+    std::map<ShapeKey, Entry> entries;
+    std::map<btCollisionShape*, ShapeKey> keys;
+};
@@ -0,0 +1,184 @@
+/*
+Terrain class - v1
+- creation of a single static rigid body for all the tiles and the invisible walls of a track, using a Compound Shape
+- friction and restitution of each part of the terrain, applied to the contacts using a material callback
+
+With a single static body, the broadphase tracks only one proxy for the whole track (instead of one for each tile), and the tyres overlap with one object only. The Compound Shape keeps its children in a dynamic AABB tree, so the narrowphase considers only the children near the tyres.
+Adjacent tiles of the same type along the same row are merged in a single box child, so the number of children (and of seams between them) is much smaller than the number of tiles. The box shapes are shared between children with the same size (see the shape interning of the Physics class).
+
+Since the terrain is a single body, it has a single friction coefficient: the friction of the different surfaces (grass, asphalt, walls) is restored in the contact added callback, where Bullet gives us the index of the child shape involved in the contact.
+
+When the other body is a tyre (see FrictionTable class), friction and rolling friction of the contact are taken from the table of the tyre/surface pairs.
+
+The callback can be used by any static body with different surfaces (e.g., the chunks of the heightfield terrain): the user pointer of the body must point to a SurfaceMap, which gives the material for the part of the body reported by Bullet.
+
+N.B.) the callback is called only when a contact point is created, and the friction is stored in the contact point for its whole life
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <utils/Physics.hpp>
+#include <utils/Track.hpp>
+#include <utils/Friction.hpp>
+
+// interface for the static bodies with different surfaces (the user pointer of the body must point to it)
+class SurfaceMap
+{
+public:
+    virtual ~SurfaceMap() {}
+    // material of the part of the body involved in a contact (partId and index are the ones provided by Bullet)
+    virtual const SurfaceMaterial& Surface(int partId, int index) const = 0;
+};
+
+// material callback (see below)
+bool terrainContactCallback(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0, int index0, const btCollisionObjectWrapper* colObj1Wrap, int partId1, int index1);
+
+///////////////////  Terrain class ///////////////////////
+class Terrain : public SurfaceMap
+{
+public:
+    // the static rigid body of the whole track
+    btRigidBody* body;
+    // the Compound Shape of the body
+    btCompoundShape* shape;
+    // material of each child of the Compound Shape (index in the materials vector)
+    vector<unsigned char> childMaterials;
+    // physical properties of the surfaces: the tile types of the track, followed by the walls
+    vector<SurfaceMaterial> materials;
+
+    //////////////////////////////////////////
+    // constructor: we build the Compound Shape for the track, and we add the body to the simulation
+    Terrain(Physics& simulation, const Track& track)
+        : simulation(simulation)
+    {
+        this->materials = track.materials;
+        unsigned char wallMaterial = this->materials.size();
+        SurfaceMaterial wall = { 0.0f, 0.0f, SURFACE_NONE };
+        this->materials.push_back(wall);
+
+        this->shape = new btCompoundShape();
+
+        // Tiles: each run of adjacent tiles with the same type along a row becomes a single box
+        for (GLuint z = 0; z < track.height; z++) {
+            GLuint x = 0;
+            while (x < track.width) {
+                GLuint first = z * track.width + x;
+                unsigned char type = track.Type(first);
+                GLuint run = 1;
+                while (x + run < track.width && track.Type(first + run) == type)
+                    run++;
+
+                // center of the run
+                glm::vec3 pos = (track.Position(first) + track.Position(first + run - 1)) * 0.5f;
+                glm::vec3 size = glm::vec3(track.edge * run, 0.0f, track.edge);
+                if (track.Paved(first)) {
+                    // asphalt is slightly higher than grass
+                    pos += glm::vec3(0.0f, 0.05f, 0.0f);
+                    size += glm::vec3(0.0f, 0.05f, 0.0f);
+                }
+                this->addChild(simulation, pos, size, type);
+                x += run;
+            }
+        }
+
+        // Invisible walls
+        for (GLuint i = 0; i < track.walls.size(); i++)
+            this->addChild(simulation, track.walls[i].center, track.walls[i].halfSize, wallMaterial);
+
+        // the friction and restitution of the body are neutral values: the actual ones are set by the material callback
+        this->body = simulation.createStaticBody(this->shape, glm::vec3(0.0f), 1.0f, 1.0f, COLL_TERRAIN, COLL_EVERYTHING);
+        this->body->setCollisionFlags(this->body->getCollisionFlags() | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
+        this->body->setUserPointer((SurfaceMap*)this);
+        gContactAddedCallback = terrainContactCallback;
+    }
+
+    // destructor: the body is removed from the simulation, and the Compound Shape is deleted (its shared boxes are released)
+    ~Terrain()
+    {
+        this->simulation.deleteRigidBody(this->body);
+    }
+
+    //////////////////////////////////////////
+    // material of the part of the terrain with the given child index
+    // (for an invalid index, a neutral material: the contact keeps the friction and restitution of the other body, as for a plain body)
+    const SurfaceMaterial& Surface(int partId, int childIndex) const
+    {
+        static const SurfaceMaterial neutral = { 1.0f, 1.0f, SURFACE_NONE };
+        if (childIndex < 0 || childIndex >= (int)this->childMaterials.size())
+            return neutral;
+        return this->materials[this->childMaterials[childIndex]];
+    }
+
+private:
+    Physics& simulation;
+
+    //////////////////////////////////////////
+    // we add a box child to the Compound Shape (boxes with the same size share the same shape, see Physics class)
+    void addChild(Physics& simulation, glm::vec3 pos, glm::vec3 size, unsigned char material)
+    {
+        btCollisionShape* box = simulation.getShape(BOX, size);
+
+        btTransform childTransform;
+        childTransform.setIdentity();
+        childTransform.setOrigin(btVector3(pos.x, pos.y, pos.z));
+        this->shape->addChildShape(childTransform, box);
+        this->childMaterials.push_back(material);
+    }
+};
+
+//////////////////////////////////////////
+// material callback: we combine friction and restitution of the other body with the ones of the part of the static body involved in the contact
+// for tyres, the grip factor and the rolling resistance come from the table of the tyre/surface pairs, otherwise we use the same rule used by Bullet for two bodies (the product of the two coefficients)
+bool terrainContactCallback(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0, int index0, const btCollisionObjectWrapper* colObj1Wrap, int partId1, int index1)
+{
+    const btCollisionObject* obj0 = colObj0Wrap->getCollisionObject();
+    const btCollisionObject* obj1 = colObj1Wrap->getCollisionObject();
+    const btCollisionObject* other;
+    const SurfaceMap* surfaces;
+    int part, index;
+
+    if (obj0->getCollisionFlags() & btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK) {
+        surfaces = (const SurfaceMap*)obj0->getUserPointer();
+        other = obj1;
+        part = partId0;
+        index = index0;
+    } else {
+        surfaces = (const SurfaceMap*)obj1->getUserPointer();
+        other = obj0;
+        part = partId1;
+        index = index1;
+    }
+
+    if (surfaces && index >= 0) {
+        const SurfaceMaterial& material = surfaces->Surface(part, index);
+        int tyre = other->getUserIndex();
+        if (tyre >= 0 && tyre < TYRE_TYPES && material.surface < SURFACE_NONE) {
+            const TyreSurface& pair = FrictionTable::Static().Lookup(tyre, material.surface);
+            cp.m_combinedFriction = other->getFriction() * pair.grip;
+            cp.m_combinedRollingFriction = pair.rolling;
+        } else {
+            cp.m_combinedFriction = other->getFriction() * material.friction;
+        }
+        cp.m_combinedRestitution = other->getRestitution() * material.restitution;
+    }
+    return true;
+}
+
+//////////////////////////////////////////
+// grip factor of a tyre of the given type on the part of the static body involved in a contact (the same value used by the material callback)
+GLfloat surfaceGrip(int tyre, const btCollisionObject* ground, int partId, int index)
+{
+    if (!(ground->getCollisionFlags() & btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK) || !ground->getUserPointer() || index < 0)
+        return ground->getFriction();
+    const SurfaceMaterial& material = ((const SurfaceMap*)ground->getUserPointer())->Surface(partId, index);
+    if (tyre >= 0 && tyre < TYRE_TYPES && material.surface < SURFACE_NONE)
+        return FrictionTable::Static().Lookup(tyre, material.surface).grip;
+    return material.friction;
+}
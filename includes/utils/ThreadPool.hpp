@@ -0,0 +1,170 @@
+/*
+ThreadPool class - v1
+- fixed set of worker threads, created once and reused at each frame
+- work stealing: each worker has its own queue of tasks, and an idle worker takes tasks from the queues of the other workers
+- the thread calling Wait works too, so a pool with n workers runs n + 1 tasks at the same time
+
+The tasks are distributed round-robin among the queues when they are submitted. Each worker takes the tasks of its own queue from the back (the last submitted task is the one with the hottest data), and it steals from the front of the other queues, so the owner and the thief rarely contend on the same end. With tasks of uneven cost (e.g., regions with different numbers of awake vehicles), the workers which finish first steal the remaining tasks, and all the threads stay busy until the end of the batch.
+
+Each queue is protected by its own mutex: the tasks are coarse (e.g., a whole stepSimulation of a sub-world), so a lock for each task is negligible, and a lock-free deque is not needed.
+
+N.B. 1) Wait returns when all the submitted tasks are completed: it is the synchronization point between the batches
+N.B. 2) the tasks must not throw exceptions, and they must not submit other tasks
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+///////////////////  ThreadPool class ///////////////////////
+class ThreadPool
+{
+public:
+    //////////////////////////////////////////
+    // constructor: we start the workers (by default, one for each hardware thread, except the calling one; with 0 workers, the tasks run on the calling thread)
+    ThreadPool(int workers = -1)
+    {
+        if (workers < 0) {
+            unsigned int hardware = thread::hardware_concurrency();
+            workers = (hardware > 1) ? hardware - 1 : 0;
+        }
+        this->queued = 0;
+        this->pending = 0;
+        this->next = 0;
+        this->stopping = false;
+        // the last queue belongs to the thread calling Wait
+        for (int i = 0; i < workers + 1; i++)
+            this->queues.push_back(new Queue());
+        for (int i = 0; i < workers; i++)
+            this->workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+    }
+
+    // destructor: we stop and join the workers
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(this->mtx);
+            this->stopping = true;
+        }
+        this->taskCv.notify_all();
+        for (unsigned int i = 0; i < this->workers.size(); i++)
+            this->workers[i].join();
+        for (unsigned int i = 0; i < this->queues.size(); i++)
+            delete this->queues[i];
+    }
+
+    //////////////////////////////////////////
+    // number of threads running the tasks (the workers and the thread calling Wait)
+    unsigned int Size() const
+    {
+        return this->queues.size();
+    }
+
+    //////////////////////////////////////////
+    // we add a task to the next queue (round-robin), and we wake up a worker
+    void Submit(const function<void()>& task)
+    {
+        Queue* queue = this->queues[this->next];
+        this->next = (this->next + 1) % this->queues.size();
+        {
+            lock_guard<mutex> lock(queue->mtx);
+            queue->tasks.push_back(task);
+        }
+        this->pending++;
+        {
+            lock_guard<mutex> lock(this->mtx);
+            this->queued++;
+        }
+        this->taskCv.notify_one();
+    }
+
+    //////////////////////////////////////////
+    // the calling thread runs tasks until all the submitted tasks are completed
+    void Wait()
+    {
+        unsigned int self = this->queues.size() - 1;
+        while (this->pending > 0) {
+            if (this->runOne(self))
+                continue;
+            // the remaining tasks are running on the workers
+            unique_lock<mutex> lock(this->mtx);
+            this->doneCv.wait(lock, [this] { return this->pending == 0 || this->queued > 0; });
+        }
+    }
+
+private:
+    // queue of the tasks of a thread
+    struct Queue
+    {
+        deque<function<void()>> tasks;
+        mutex mtx;
+    };
+
+    vector<Queue*> queues;
+    vector<thread> workers;
+    // round-robin index of the queue of the next submitted task (used only by the submitting thread)
+    unsigned int next;
+    // tasks not completed yet
+    atomic<int> pending;
+    // tasks in the queues, and stop request (protected by the mutex)
+    int queued;
+    bool stopping;
+    mutex mtx;
+    condition_variable taskCv, doneCv;
+
+    //////////////////////////////////////////
+    // we run a task of our queue (from the back), or we steal one from the other queues (from the front)
+    bool runOne(unsigned int self)
+    {
+        function<void()> task;
+        unsigned int count = this->queues.size();
+        for (unsigned int i = 0; i < count && !task; i++) {
+            Queue* queue = this->queues[(self + i) % count];
+            lock_guard<mutex> lock(queue->mtx);
+            if (queue->tasks.empty())
+                continue;
+            if (i == 0) {
+                task = queue->tasks.back();
+                queue->tasks.pop_back();
+            } else {
+                task = queue->tasks.front();
+                queue->tasks.pop_front();
+            }
+        }
+        if (!task)
+            return false;
+
+        {
+            lock_guard<mutex> lock(this->mtx);
+            this->queued--;
+        }
+        task();
+        if (--this->pending == 0) {
+            lock_guard<mutex> lock(this->mtx);
+            this->doneCv.notify_all();
+        }
+        return true;
+    }
+
+    // loop of a worker: it runs tasks while there are some in the queues, otherwise it sleeps
+    void workerLoop(unsigned int index)
+    {
+        while (true) {
+            if (this->runOne(index))
+                continue;
+            unique_lock<mutex> lock(this->mtx);
+            this->taskCv.wait(lock, [this] { return this->stopping || this->queued > 0; });
+            if (this->stopping && this->queued == 0)
+                return;
+        }
+    }
+};
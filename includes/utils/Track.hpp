@@ -0,0 +1,270 @@
+/*
+Track class - v1
+- grid of square tiles (grass or asphalt) describing the track, shared by rendering and physics
+- spatial queries on the tiles: visible tiles (frustum culling), nearest tile to a position, tiles inside a region (streaming)
+- surface materials, walls and spawn points of the track, built in the code or loaded from a track file (see TrackFile class)
+
+The tiles are stored in a single array (one byte per tile, row by row along the z axis), and their positions are computed when needed, so a track of 1000x1000 tiles requires only 1 MB.
+When the track is loaded from a file, the array is not copied: the tiles are read in place from the TrackFile (which must live as long as the Track).
+The visibility query uses an implicit quadtree over the grid: each node is a rectangle of tiles, its bounding box is computed from the rectangle, and nothing else is stored. Nodes outside the frustum are discarded with all their tiles, nodes completely inside are accepted without further tests, and only the small nodes intersecting the frustum borders are tested tile by tile.
+
+N.B.) tile (x, z) is centered at (2*edge*x - edge*(width-1), 0, 2*edge*z - edge*(height-1)), so the track is centered in the origin
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <utils/Frustum.hpp>
+#include <utils/TrackFile.hpp>
+
+// enum to identify the tile types
+enum tiletypes { TILE_GRASS, TILE_ASPHALT };
+
+// physical properties of a surface (surface is a value of the surfacetypes enum)
+struct SurfaceMaterial {
+    GLfloat friction;
+    GLfloat restitution;
+    GLuint surface;
+};
+
+// invisible wall (box)
+struct TrackWall {
+    glm::vec3 center;
+    glm::vec3 halfSize;
+};
+
+///////////////////  Track class ///////////////////////
+class Track
+{
+public:
+    // number of tiles along the x (width) and z (height) axes
+    GLuint width, height;
+    // half size of the edge of a tile
+    GLfloat edge;
+    // vertical extent of the tiles (used for their bounding boxes)
+    GLfloat minY, maxY;
+    // type of each tile (index in the materials vector), stored as tileData[z*width + x]
+    const unsigned char* tileData;
+    // physical properties of each tile type (indexed by type)
+    vector<SurfaceMaterial> materials;
+    // invisible walls
+    vector<TrackWall> walls;
+    // start positions of the vehicles
+    vector<glm::vec3> spawns;
+
+    //////////////////////////////////////////
+    // constructor: layout contains width*height tile types (row by row), if NULL all the tiles are grass
+    // the track has the default materials, 4 walls along its borders, and a spawn point in the origin
+    Track(GLuint width, GLuint height, GLfloat edge, const unsigned char* layout = NULL)
+    {
+        this->width = width;
+        this->height = height;
+        this->edge = edge;
+        this->minY = -0.5f;
+        this->maxY = 0.5f;
+        if (layout)
+            this->tiles.assign(layout, layout + width * height);
+        else
+            this->tiles.assign(width * height, TILE_GRASS);
+        this->tileData = &this->tiles[0];
+
+        // default materials: grass, asphalt
+        SurfaceMaterial grass = { 0.25f, 0.25f, SURFACE_GRASS };
+        SurfaceMaterial asphalt = { 0.5f, 0.5f, SURFACE_ASPHALT };
+        this->materials.push_back(grass);
+        this->materials.push_back(asphalt);
+
+        // default walls, along the borders of the track
+        GLfloat side = this->HalfHeight();
+        this->addWall(glm::vec3(0.0f, 2.5f, -side), glm::vec3(2*side, 5.0f, 0.0f));
+        this->addWall(glm::vec3(0.0f, 2.5f, side), glm::vec3(2*side, 5.0f, 0.0f));
+        side = this->HalfWidth();
+        this->addWall(glm::vec3(-side, 2.5f, 0.0f), glm::vec3(0.0f, 5.0f, 2*side));
+        this->addWall(glm::vec3(side, 2.5f, 0.0f), glm::vec3(0.0f, 5.0f, 2*side));
+
+        this->spawns.push_back(glm::vec3(0.0f));
+    }
+
+    //////////////////////////////////////////
+    // constructor: track loaded from file (the tiles are used in place, the other tables are small and they are copied)
+    Track(const TrackFile& file)
+    {
+        this->width = file.header->width;
+        this->height = file.header->height;
+        this->edge = file.header->edge;
+        this->minY = -0.5f;
+        this->maxY = 0.5f;
+        this->tileData = file.tiles;
+
+        for (GLuint i = 0; i < file.header->materialCount; i++) {
+            SurfaceMaterial material = { file.materials[i].friction, file.materials[i].restitution, glm::min(file.materials[i].surface, (GLuint)SURFACE_NONE) };
+            this->materials.push_back(material);
+        }
+        for (GLuint i = 0; i < file.header->wallCount; i++)
+            this->addWall(glm::make_vec3(file.walls[i].center), glm::make_vec3(file.walls[i].halfSize));
+        for (GLuint i = 0; i < file.header->spawnCount; i++)
+            this->spawns.push_back(glm::make_vec3(file.spawns[i].position));
+        if (this->spawns.empty())
+            this->spawns.push_back(glm::vec3(0.0f));
+    }
+
+    //////////////////////////////////////////
+    // number of tiles of the track
+    GLuint Count() const { return this->width * this->height; }
+
+    // type of the tile with the given index
+    unsigned char Type(GLuint index) const { return this->tileData[index]; }
+
+    // true if the surface of the tile is asphalt (dry or wet)
+    bool Paved(GLuint index) const
+    {
+        GLuint surface = this->materials[this->Type(index)].surface;
+        return surface == SURFACE_ASPHALT || surface == SURFACE_WET;
+    }
+
+    // grid coordinates of the tile with the given index
+    GLuint TileX(GLuint index) const { return index % this->width; }
+    GLuint TileZ(GLuint index) const { return index / this->width; }
+
+    // center of the tile with the given index
+    glm::vec3 Position(GLuint index) const
+    {
+        return glm::vec3(2*this->edge*this->TileX(index) - this->edge*(this->width-1), 0.0f, 2*this->edge*this->TileZ(index) - this->edge*(this->height-1));
+    }
+
+    // half size of the whole track along x and z
+    GLfloat HalfWidth() const { return this->edge * this->width; }
+    GLfloat HalfHeight() const { return this->edge * this->height; }
+
+    //////////////////////////////////////////
+    // index of the tile containing the position (or the nearest one, if the position is outside the track)
+    GLuint NearestTile(const glm::vec3& pos) const
+    {
+        GLint x = (GLint)glm::floor((pos.x + this->HalfWidth()) / (2*this->edge));
+        GLint z = (GLint)glm::floor((pos.z + this->HalfHeight()) / (2*this->edge));
+        x = glm::clamp(x, 0, (GLint)this->width - 1);
+        z = glm::clamp(z, 0, (GLint)this->height - 1);
+        return z * this->width + x;
+    }
+
+    //////////////////////////////////////////
+    // indices of the tiles overlapping the square region centered in pos (e.g., the tiles to load around a vehicle)
+    void TilesInRegion(const glm::vec3& pos, GLfloat radius, vector<GLuint>& result) const
+    {
+        result.clear();
+        GLuint x0, z0, x1, z1;
+        if (!this->tileRange(pos.x - radius, pos.z - radius, pos.x + radius, pos.z + radius, x0, z0, x1, z1))
+            return;
+        for (GLuint z = z0; z <= z1; z++)
+            for (GLuint x = x0; x <= x1; x++)
+                result.push_back(z * this->width + x);
+    }
+
+    //////////////////////////////////////////
+    // indices of the tiles inside the view frustum (the counters of the frustum are updated)
+    void VisibleTiles(Frustum& frustum, vector<GLuint>& result) const
+    {
+        result.clear();
+        this->visitNode(frustum, 0, 0, this->width, this->height, result);
+    }
+
+    // we add an invisible wall
+    void addWall(const glm::vec3& center, const glm::vec3& halfSize)
+    {
+        TrackWall wall = { center, halfSize };
+        this->walls.push_back(wall);
+    }
+
+private:
+    // tiles owned by the track (when they are not loaded from file)
+    vector<unsigned char> tiles;
+
+    // the pointer to the tiles would refer to the tiles of the copied track
+    Track(const Track&);
+    Track& operator=(const Track&);
+
+    // nodes with this number of tiles (or less) along each side are tested tile by tile
+    static const GLuint LEAF_SIZE = 4;
+
+    //////////////////////////////////////////
+    // bounding box of the rectangle of tiles [x0, x1) x [z0, z1)
+    void nodeBounds(GLuint x0, GLuint z0, GLuint x1, GLuint z1, glm::vec3& boxMin, glm::vec3& boxMax) const
+    {
+        boxMin = glm::vec3(2*this->edge*x0 - this->HalfWidth(), this->minY, 2*this->edge*z0 - this->HalfHeight());
+        boxMax = glm::vec3(2*this->edge*x1 - this->HalfWidth(), this->maxY, 2*this->edge*z1 - this->HalfHeight());
+    }
+
+    // recursive visit of the implicit quadtree
+    void visitNode(Frustum& frustum, GLuint x0, GLuint z0, GLuint x1, GLuint z1, vector<GLuint>& result) const
+    {
+        if (x0 >= x1 || z0 >= z1)
+            return;
+
+        glm::vec3 boxMin, boxMax;
+        this->nodeBounds(x0, z0, x1, z1, boxMin, boxMax);
+        GLuint count = (x1 - x0) * (z1 - z0);
+        int test = frustum.Classify(boxMin, boxMax);
+
+        if (test == FRUSTUM_OUTSIDE)
+        {
+            frustum.tested += count;
+            frustum.culled += count;
+            return;
+        }
+        if (test == FRUSTUM_INSIDE)
+        {
+            frustum.tested += count;
+            for (GLuint z = z0; z < z1; z++)
+                for (GLuint x = x0; x < x1; x++)
+                    result.push_back(z * this->width + x);
+            return;
+        }
+        if (x1 - x0 <= LEAF_SIZE && z1 - z0 <= LEAF_SIZE)
+        {
+            for (GLuint z = z0; z < z1; z++)
+            {
+                for (GLuint x = x0; x < x1; x++)
+                {
+                    this->nodeBounds(x, z, x + 1, z + 1, boxMin, boxMax);
+                    if (frustum.IsVisible(boxMin, boxMax))
+                        result.push_back(z * this->width + x);
+                }
+            }
+            return;
+        }
+
+        // the node is split in 4 children
+        GLuint xm = (x0 + x1 + 1) / 2;
+        GLuint zm = (z0 + z1 + 1) / 2;
+        this->visitNode(frustum, x0, z0, xm, zm, result);
+        this->visitNode(frustum, xm, z0, x1, zm, result);
+        this->visitNode(frustum, x0, zm, xm, z1, result);
+        this->visitNode(frustum, xm, zm, x1, z1, result);
+    }
+
+    //////////////////////////////////////////
+    // range of tiles overlapping the rectangle [minX, maxX] x [minZ, maxZ] (false if it is outside the track)
+    bool tileRange(GLfloat minX, GLfloat minZ, GLfloat maxX, GLfloat maxZ, GLuint& x0, GLuint& z0, GLuint& x1, GLuint& z1) const
+    {
+        GLint ix0 = (GLint)glm::floor((minX + this->HalfWidth()) / (2*this->edge));
+        GLint iz0 = (GLint)glm::floor((minZ + this->HalfHeight()) / (2*this->edge));
+        GLint ix1 = (GLint)glm::floor((maxX + this->HalfWidth()) / (2*this->edge));
+        GLint iz1 = (GLint)glm::floor((maxZ + this->HalfHeight()) / (2*this->edge));
+        if (ix1 < 0 || iz1 < 0 || ix0 >= (GLint)this->width || iz0 >= (GLint)this->height)
+            return false;
+        x0 = glm::max(ix0, 0);
+        z0 = glm::max(iz0, 0);
+        x1 = glm::min(ix1, (GLint)this->width - 1);
+        z1 = glm::min(iz1, (GLint)this->height - 1);
+        return true;
+    }
+};
@@ -0,0 +1,316 @@
+/*
+TrackFile class - v1
+- loading of a track description (tiles, surface materials, walls, spawn points) from file
+- binary format, memory-mapped and used in place (no parsing, no copies)
+- text format (human-readable source of the binary files), converted in memory to the binary layout
+
+A binary track file is read with mmap: the header, the tables and the tiles are accessed directly through pointers to the mapped file, so even a track with millions of tiles is loaded without parsing or copies. The only pass over the tiles at loading is the check that their values are valid material indices (a corrupt or malicious file would otherwise make the Track and Terrain classes read outside their material tables).
+The text format is parsed into a buffer with exactly the same layout of the binary file, so the rest of the application does not know which format has been used. The same parser is used by the converter (tools/trackc.cpp), which writes the buffer to disk.
+
+Binary format (little endian, all the sections are aligned to 4 bytes):
+- header (TrackFileHeader data structure)
+- materials: materialCount TrackFileMaterial (the tile values are indices in this table, the surface is a value of the surfacetypes enum)
+- walls: wallCount TrackFileWall (boxes, center and half size)
+- spawns: spawnCount TrackFileSpawn (start positions of the vehicles)
+- tiles: width*height unsigned 8 bit values, row by row along the z axis
+
+Text format (one directive for each line, # starts a comment):
+    size <width> <height>
+    edge <half size of the edge of a tile>
+    material <surface> <friction> <restitution>     (surface: grass, asphalt, wet, gravel, or any other name for surfaces without a type)
+    wall <center x> <center y> <center z> <half size x> <half size y> <half size z>
+    spawn <x> <y> <z>
+    tiles
+    <height lines of width digits, one for each tile>
+
+N.B. 1) the magic of the header is the version of the format: "TRK2" added the surface type of the materials (12 bytes instead of 8), and files of the previous version ("TRK1") are rejected, they must be converted again from their text sources
+N.B. 2) the TrackFile must live as long as the Track objects created from it (they use its tiles in place)
+N.B. 3) this header does not depend on OpenGL or Bullet, so it can be used also by command line tools
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+// memory mapping of files
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// enum to identify the surface types (used by the tyre friction model, see FrictionTable class)
+enum surfacetypes { SURFACE_GRASS, SURFACE_ASPHALT, SURFACE_WET, SURFACE_GRAVEL, SURFACE_NONE };
+
+// names of the surface types in the text format
+static const char* surfaceNames[SURFACE_NONE] = { "grass", "asphalt", "wet", "gravel" };
+
+// data structures of the binary format
+struct TrackFileHeader {
+    char magic[4];              // "TRK2"
+    uint32_t width;             // number of tiles along x
+    uint32_t height;            // number of tiles along z
+    float edge;                 // half size of the edge of a tile
+    uint32_t materialCount;
+    uint32_t wallCount;
+    uint32_t spawnCount;
+    uint32_t reserved;
+};
+
+struct TrackFileMaterial {
+    float friction;
+    float restitution;
+    uint32_t surface;
+};
+
+struct TrackFileWall {
+    float center[3];
+    float halfSize[3];
+};
+
+struct TrackFileSpawn {
+    float position[3];
+};
+
+/////////////////// TRACK FILE class ///////////////////////
+class TrackFile
+{
+public:
+    // sections of the file (pointers inside the mapped file, or inside the buffer built from a text file)
+    const TrackFileHeader* header;
+    const TrackFileMaterial* materials;
+    const TrackFileWall* walls;
+    const TrackFileSpawn* spawns;
+    const unsigned char* tiles;
+
+    //////////////////////////////////////////
+    TrackFile() : header(NULL), materials(NULL), walls(NULL), spawns(NULL), tiles(NULL), mapped(NULL), size(0) {}
+
+    ~TrackFile()
+    {
+        this->Close();
+    }
+
+    //////////////////////////////////////////
+    // we open a track file: binary files are mapped in memory, text files are converted to the binary layout
+    bool Open(const char* path)
+    {
+        this->Close();
+
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            cout << "ERROR::TRACK:: cannot open " << path << endl;
+            return false;
+        }
+        struct stat info;
+        fstat(fd, &info);
+        size_t fileSize = info.st_size;
+        void* data = (fileSize > 0) ? mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        // the mapping is still valid after closing the file
+        close(fd);
+        if (data == MAP_FAILED) {
+            cout << "ERROR::TRACK:: cannot map " << path << endl;
+            return false;
+        }
+
+        if (fileSize >= 4 && memcmp(data, "TRK1", 4) == 0) {
+            // previous version of the binary format: the materials have a different size
+            cout << "ERROR::TRACK:: " << path << " has an old binary format (TRK1), convert it again with trackc" << endl;
+            munmap(data, fileSize);
+            return false;
+        }
+        if (fileSize >= 4 && memcmp(data, "TRK2", 4) == 0) {
+            // binary file: it is used in place
+            this->mapped = data;
+            this->size = fileSize;
+            if (!this->setSections((const unsigned char*)this->mapped, this->size)) {
+                cout << "ERROR::TRACK:: invalid file " << path << endl;
+                this->Close();
+                return false;
+            }
+            return true;
+        }
+
+        // text file: it is converted to the binary layout
+        string error;
+        bool parsed = Compile((const char*)data, fileSize, this->buffer, error);
+        munmap(data, fileSize);
+        if (!parsed || !this->setSections(&this->buffer[0], this->buffer.size())) {
+            cout << "ERROR::TRACK:: " << path << ": " << error << endl;
+            this->Close();
+            return false;
+        }
+        return true;
+    }
+
+    //////////////////////////////////////////
+    // the mapping (or the buffer) is released
+    void Close()
+    {
+        if (this->mapped)
+            munmap(this->mapped, this->size);
+        this->mapped = NULL;
+        this->size = 0;
+        vector<unsigned char>().swap(this->buffer);
+        this->header = NULL;
+        this->materials = NULL;
+        this->walls = NULL;
+        this->spawns = NULL;
+        this->tiles = NULL;
+    }
+
+    //////////////////////////////////////////
+    // we parse a track in text format, and we write it in output with the layout of the binary format
+    // (in case of errors, false is returned and error contains a description)
+    static bool Compile(const char* text, size_t length, vector<unsigned char>& output, string& error)
+    {
+        TrackFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "TRK2", 4);
+        header.edge = 1.0f;
+        vector<TrackFileMaterial> materials;
+        vector<TrackFileWall> walls;
+        vector<TrackFileSpawn> spawns;
+        vector<unsigned char> tiles;
+
+        istringstream input(string(text, length));
+        string line;
+        unsigned int lineNumber = 0;
+        while (getline(input, line)) {
+            lineNumber++;
+            // comments
+            size_t comment = line.find('#');
+            if (comment != string::npos)
+                line.erase(comment);
+            istringstream fields(line);
+            string directive;
+            if (!(fields >> directive))
+                continue;
+
+            bool valid = true;
+            if (directive == "size") {
+                valid = (bool)(fields >> header.width >> header.height);
+            } else if (directive == "edge") {
+                valid = (bool)(fields >> header.edge);
+            } else if (directive == "material") {
+                string name;
+                TrackFileMaterial material;
+                valid = (bool)(fields >> name >> material.friction >> material.restitution);
+                material.surface = SURFACE_NONE;
+                for (unsigned int i = 0; i < SURFACE_NONE; i++) {
+                    if (name == surfaceNames[i])
+                        material.surface = i;
+                }
+                materials.push_back(material);
+            } else if (directive == "wall") {
+                TrackFileWall wall;
+                valid = (bool)(fields >> wall.center[0] >> wall.center[1] >> wall.center[2] >> wall.halfSize[0] >> wall.halfSize[1] >> wall.halfSize[2]);
+                walls.push_back(wall);
+            } else if (directive == "spawn") {
+                TrackFileSpawn spawn;
+                valid = (bool)(fields >> spawn.position[0] >> spawn.position[1] >> spawn.position[2]);
+                spawns.push_back(spawn);
+            } else if (directive == "tiles") {
+                // the following lines contain the tiles, one row for each line
+                while (tiles.size() < (size_t)header.width * header.height && getline(input, line)) {
+                    lineNumber++;
+                    for (size_t i = 0; i < line.size(); i++) {
+                        if (line[i] >= '0' && line[i] <= '9')
+                            tiles.push_back(line[i] - '0');
+                        else if (line[i] == '#')
+                            break;
+                    }
+                }
+            } else {
+                valid = false;
+            }
+
+            if (!valid) {
+                error = "invalid line " + to_string(lineNumber) + ": " + line;
+                return false;
+            }
+        }
+
+        if (header.width == 0 || header.height == 0) {
+            error = "missing track size";
+            return false;
+        }
+        if (tiles.size() != (size_t)header.width * header.height) {
+            error = "expected " + to_string(header.width * header.height) + " tiles, found " + to_string(tiles.size());
+            return false;
+        }
+        for (size_t i = 0; i < tiles.size(); i++) {
+            if (tiles[i] >= materials.size()) {
+                error = "tile " + to_string(i) + " uses the undefined material " + to_string(tiles[i]);
+                return false;
+            }
+        }
+        header.materialCount = materials.size();
+        header.wallCount = walls.size();
+        header.spawnCount = spawns.size();
+
+        output.clear();
+        append(output, &header, sizeof(header));
+        append(output, materials.empty() ? NULL : &materials[0], materials.size() * sizeof(TrackFileMaterial));
+        append(output, walls.empty() ? NULL : &walls[0], walls.size() * sizeof(TrackFileWall));
+        append(output, spawns.empty() ? NULL : &spawns[0], spawns.size() * sizeof(TrackFileSpawn));
+        append(output, &tiles[0], tiles.size());
+        return true;
+    }
+
+private:
+    // mapped binary file
+    void* mapped;
+    size_t size;
+    // binary layout built from a text file
+    vector<unsigned char> buffer;
+
+    TrackFile(const TrackFile&);
+    TrackFile& operator=(const TrackFile&);
+
+    //////////////////////////////////////////
+    // we set the pointers to the sections, checking that they are inside the data, and that the tiles use existing materials
+    bool setSections(const unsigned char* data, size_t dataSize)
+    {
+        if (dataSize < sizeof(TrackFileHeader))
+            return false;
+        this->header = (const TrackFileHeader*)data;
+        size_t offset = sizeof(TrackFileHeader);
+        size_t tableSize = (size_t)this->header->materialCount * sizeof(TrackFileMaterial)
+            + (size_t)this->header->wallCount * sizeof(TrackFileWall)
+            + (size_t)this->header->spawnCount * sizeof(TrackFileSpawn);
+        size_t tileCount = (size_t)this->header->width * this->header->height;
+        if (tileCount == 0 || dataSize < offset + tableSize + tileCount)
+            return false;
+
+        this->materials = (const TrackFileMaterial*)(data + offset);
+        offset += this->header->materialCount * sizeof(TrackFileMaterial);
+        this->walls = (const TrackFileWall*)(data + offset);
+        offset += this->header->wallCount * sizeof(TrackFileWall);
+        this->spawns = (const TrackFileSpawn*)(data + offset);
+        offset += this->header->spawnCount * sizeof(TrackFileSpawn);
+        this->tiles = data + offset;
+
+        // each tile must be an index in the material table
+        for (size_t i = 0; i < tileCount; i++) {
+            if (this->tiles[i] >= this->header->materialCount)
+                return false;
+        }
+        return true;
+    }
+
+    static void append(vector<unsigned char>& output, const void* data, size_t bytes)
+    {
+        const unsigned char* begin = (const unsigned char*)data;
+        if (bytes > 0)
+            output.insert(output.end(), begin, begin + bytes);
+    }
+};
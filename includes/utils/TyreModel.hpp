@@ -0,0 +1,319 @@
+/*
+TyreModel class - v1
+- longitudinal and lateral tyre forces computed with the Pacejka "Magic Formula", from slip ratio and slip angle
+- the forces of all the wheels of all the vehicles are computed in a single batch, at each physics tick
+
+The update has 3 phases:
+1) gather: a single pass over the contact manifolds of the dynamics world finds the contacts between the wheels and the static bodies (the Vehicle is found through the user pointer of the wheel). For each wheel we store the velocities at the contact point, the normal load (from the impulses applied by the solver at the previous tick) and the friction coefficient of the surface
+2) kernel: slip ratio, slip angle, Magic Formula and friction circle are computed on arrays of floats (structure of arrays), 4 wheels at a time with SSE instructions
+3) scatter: the forces are applied to the wheel bodies at the contact points
+
+F = D * sin(C * atan(B*x - E*(B*x - atan(B*x)))), where x is the slip ratio (longitudinal force) or the slip angle (lateral force), and D = mu * load is the peak force.
+The sum of the two forces is limited to D (friction circle).
+atan and sin are computed with polynomial approximations (max error about 0.002), both in the SSE and in the scalar version, so the results do not depend on the instruction set.
+
+N.B. 1) the forces are applied only to the vehicles with the tyre model enabled: their tyres have no Bullet friction (see Vehicle class), so the contacts give only the normal forces
+N.B. 2) at low speed the slips are computed with a minimum reference speed, to avoid the singularity at 0 m/s
+N.B. 3) the wheels of the sleeping vehicles are skipped (their slots have no load, so they get no forces)
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define TYREMODEL_SSE 1
+#endif
+
+#include <utils/Physics.hpp>
+#include <utils/Vehicle.hpp>
+#include <utils/Terrain.hpp>
+
+/////////////////// TYRE MODEL class ///////////////////////
+class TyreModel
+{
+public:
+    // Magic Formula coefficients: stiffness (B), shape (C), curvature (E), for the longitudinal (x) and lateral (y) forces
+    GLfloat Bx, Cx, Ex;
+    GLfloat By, Cy, Ey;
+    // minimum reference speed used to compute the slips (m/s)
+    GLfloat minSpeed;
+
+    //////////////////////////////////////////
+    // constructor: default coefficients for a road tyre
+    TyreModel()
+    {
+        this->Bx = 10.0f;
+        this->Cx = 1.9f;
+        this->Ex = 0.97f;
+        this->By = 8.0f;
+        this->Cy = 1.3f;
+        this->Ey = -1.0f;
+        this->minSpeed = 1.0f;
+        this->count = 0;
+    }
+
+    //////////////////////////////////////////
+    // we compute and apply the tyre forces of all the vehicles (called at each physics tick)
+    void Update(vector<Vehicle*>& vehicles, btDynamicsWorld* world, btScalar timeStep)
+    {
+        this->resize(vehicles.size() * WHEELS);
+        for (GLuint i = 0; i < vehicles.size(); i++)
+            vehicles[i]->batchIndex = i;
+
+        this->gather(world, timeStep);
+        this->Kernel(this->count);
+        this->scatter(vehicles, timeStep);
+    }
+
+    //////////////////////////////////////////
+    // Magic Formula and friction circle for the first n wheels of the batch (inputs: longitudinal speed, longitudinal and lateral slip speeds, load, mu)
+    void Kernel(GLuint n)
+    {
+        GLuint i = 0;
+#ifdef TYREMODEL_SSE
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128 minSpeed = _mm_set1_ps(this->minSpeed);
+        const __m128 bx = _mm_set1_ps(this->Bx), cx = _mm_set1_ps(this->Cx), ex = _mm_set1_ps(this->Ex);
+        const __m128 by = _mm_set1_ps(this->By), cy = _mm_set1_ps(this->Cy), ey = _mm_set1_ps(this->Ey);
+        for (; i + 4 <= n; i += 4)
+        {
+            // reference speed: |longitudinal speed|, at least minSpeed
+            __m128 speed = _mm_max_ps(_mm_andnot_ps(sign, _mm_loadu_ps(&this->speed[i])), minSpeed);
+            __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), speed);
+            // slip ratio and slip angle (the slip speeds are opposite to the forces)
+            __m128 kappa = _mm_mul_ps(_mm_xor_ps(_mm_loadu_ps(&this->slipX[i]), sign), inv);
+            __m128 alpha = atan4(_mm_mul_ps(_mm_xor_ps(_mm_loadu_ps(&this->slipY[i]), sign), inv));
+
+            __m128 peak = _mm_mul_ps(_mm_loadu_ps(&this->mu[i]), _mm_loadu_ps(&this->load[i]));
+            __m128 fx = _mm_mul_ps(peak, magic4(kappa, bx, cx, ex));
+            __m128 fy = _mm_mul_ps(peak, magic4(alpha, by, cy, ey));
+
+            // friction circle: the forces are scaled if their sum is greater than the peak force
+            __m128 total = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_set1_ps(1e-6f)));
+            __m128 scale = _mm_min_ps(_mm_set1_ps(1.0f), _mm_div_ps(peak, total));
+            _mm_storeu_ps(&this->forceX[i], _mm_mul_ps(fx, scale));
+            _mm_storeu_ps(&this->forceY[i], _mm_mul_ps(fy, scale));
+        }
+#endif
+        for (; i < n; i++)
+        {
+            GLfloat speed = glm::max(glm::abs(this->speed[i]), this->minSpeed);
+            GLfloat kappa = -this->slipX[i] / speed;
+            GLfloat alpha = approxAtan(-this->slipY[i] / speed);
+
+            GLfloat peak = this->mu[i] * this->load[i];
+            GLfloat fx = peak * magic(kappa, this->Bx, this->Cx, this->Ex);
+            GLfloat fy = peak * magic(alpha, this->By, this->Cy, this->Ey);
+
+            GLfloat total = sqrtf(fx * fx + fy * fy + 1e-6f);
+            GLfloat scale = glm::min(1.0f, peak / total);
+            this->forceX[i] = fx * scale;
+            this->forceY[i] = fy * scale;
+        }
+    }
+
+private:
+    // number of wheels in the batch
+    GLuint count;
+
+    // inputs of the kernel (structure of arrays, one element for each wheel)
+    vector<GLfloat> speed;      // speed of the wheel center along the forward direction
+    vector<GLfloat> slipX;      // speed of the contact point along the forward direction
+    vector<GLfloat> slipY;      // speed of the contact point along the lateral direction
+    vector<GLfloat> load;       // normal load (N)
+    vector<GLfloat> mu;         // friction coefficient
+    // outputs of the kernel
+    vector<GLfloat> forceX;
+    vector<GLfloat> forceY;
+
+    // contact data of each wheel (used by the scatter phase)
+    struct WheelContact {
+        btVector3 point;
+        btVector3 forward;
+        btVector3 lateral;
+        btScalar depth;
+        bool found;
+    };
+    vector<WheelContact> contacts;
+
+    //////////////////////////////////////////
+    // the arrays are enlarged only when the number of wheels grows (no allocations at each tick)
+    void resize(GLuint n)
+    {
+        this->count = n;
+        if (this->contacts.size() >= n)
+            return;
+        // the kernel arrays are padded to a multiple of 4 elements
+        GLuint padded = (n + 3) & ~3u;
+        this->speed.resize(padded, 0.0f);
+        this->slipX.resize(padded, 0.0f);
+        this->slipY.resize(padded, 0.0f);
+        this->load.resize(padded, 0.0f);
+        this->mu.resize(padded, 0.0f);
+        this->forceX.resize(padded, 0.0f);
+        this->forceY.resize(padded, 0.0f);
+        this->contacts.resize(n);
+    }
+
+    //////////////////////////////////////////
+    // single pass over the contact manifolds: for each wheel touching a static body we keep the deepest contact point, and we sum the normal impulses
+    void gather(btDynamicsWorld* world, btScalar timeStep)
+    {
+        for (GLuint i = 0; i < this->count; i++) {
+            this->contacts[i].found = false;
+            this->contacts[i].depth = BT_LARGE_FLOAT;
+            this->load[i] = 0.0f;
+        }
+
+        btDispatcher* dispatcher = world->getDispatcher();
+        int manifolds = dispatcher->getNumManifolds();
+        for (int m = 0; m < manifolds; m++) {
+            btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(m);
+            const btCollisionObject* body0 = manifold->getBody0();
+            const btCollisionObject* body1 = manifold->getBody1();
+
+            // the wheel can be the first or the second body of the manifold
+            for (int side = 0; side < 2; side++) {
+                const btCollisionObject* wheel = side ? body1 : body0;
+                const btCollisionObject* ground = side ? body0 : body1;
+                if (wheel->getUserIndex() < 0 || !wheel->getUserPointer() || !ground->isStaticOrKinematicObject())
+                    continue;
+                Vehicle* vehicle = (Vehicle*)wheel->getUserPointer();
+                int w = vehicle->WheelIndex(wheel);
+                if (w < 0 || !vehicle->tyreModel || vehicle->Sleeping())
+                    continue;
+                GLuint slot = vehicle->batchIndex * WHEELS + w;
+                const btRigidBody* body = btRigidBody::upcast(wheel);
+
+                for (int p = 0; p < manifold->getNumContacts(); p++) {
+                    btManifoldPoint& pt = manifold->getContactPoint(p);
+                    // the friction of the contacts created before the tyre model was enabled is removed
+                    pt.m_combinedFriction = 0.0f;
+                    if (pt.getDistance() > 0.0f)
+                        continue;
+                    this->load[slot] += pt.getAppliedImpulse() / timeStep;
+
+                    if (pt.getDistance() < this->contacts[slot].depth) {
+                        // normal of the ground (pointing towards the wheel), contact point on the ground
+                        btVector3 normal = side ? -pt.m_normalWorldOnB : pt.m_normalWorldOnB;
+                        btVector3 point = side ? pt.getPositionWorldOnA() : pt.getPositionWorldOnB();
+                        int part = side ? pt.m_partId0 : pt.m_partId1;
+                        int index = side ? pt.m_index0 : pt.m_index1;
+
+                        // lateral direction: the wheel axis (y axis of the cylinder) on the ground plane
+                        btVector3 axis = body->getWorldTransform().getBasis().getColumn(1);
+                        btVector3 lateral = axis - normal * axis.dot(normal);
+                        if (lateral.length2() < SIMD_EPSILON)
+                            continue;
+                        lateral.normalize();
+                        btVector3 forward = lateral.cross(normal);
+
+                        WheelContact& contact = this->contacts[slot];
+                        contact.found = true;
+                        contact.depth = pt.getDistance();
+                        contact.point = point;
+                        contact.forward = forward;
+                        contact.lateral = lateral;
+
+                        btVector3 contactVelocity = body->getVelocityInLocalPoint(point - body->getCenterOfMassPosition());
+                        this->speed[slot] = body->getLinearVelocity().dot(forward);
+                        this->slipX[slot] = contactVelocity.dot(forward);
+                        this->slipY[slot] = contactVelocity.dot(lateral);
+                        this->mu[slot] = vehicle->tyreFriction * surfaceGrip(wheel->getUserIndex(), ground, part, index);
+                    }
+                }
+            }
+        }
+
+        // wheels without contacts have no load, so the kernel gives no forces
+        for (GLuint i = 0; i < this->count; i++)
+            if (!this->contacts[i].found)
+                this->load[i] = 0.0f;
+    }
+
+    //////////////////////////////////////////
+    // the forces are applied at the contact points, as impulses over the tick (see Vehicle class)
+    void scatter(vector<Vehicle*>& vehicles, btScalar timeStep)
+    {
+        for (GLuint v = 0; v < vehicles.size(); v++) {
+            for (GLuint w = 0; w < WHEELS; w++) {
+                GLuint slot = v * WHEELS + w;
+                const WheelContact& contact = this->contacts[slot];
+                if (!contact.found)
+                    continue;
+                btRigidBody* wheel = vehicles[v]->wheels[w];
+                btVector3 force = contact.forward * this->forceX[slot] + contact.lateral * this->forceY[slot];
+                wheel->applyImpulse(force * timeStep, contact.point - wheel->getCenterOfMassPosition());
+            }
+        }
+    }
+
+    //////////////////////////////////////////
+    // approximations of atan and sin, and Magic Formula (scalar versions)
+    static GLfloat approxAtan(GLfloat x)
+    {
+        GLfloat a = glm::abs(x);
+        bool inverse = a > 1.0f;
+        GLfloat t = inverse ? 1.0f / a : a;
+        // atan(t) for t in [0, 1]
+        GLfloat r = 0.7853982f * t - t * (t - 1.0f) * (0.2447f + 0.0663f * t);
+        if (inverse)
+            r = 1.5707963f - r;
+        return x < 0.0f ? -r : r;
+    }
+
+    // sin(x) for x in [-pi, pi]
+    static GLfloat approxSin(GLfloat x)
+    {
+        GLfloat y = 1.2732395f * x - 0.4052847f * x * glm::abs(x);
+        return 0.225f * (y * glm::abs(y) - y) + y;
+    }
+
+    static GLfloat magic(GLfloat x, GLfloat B, GLfloat C, GLfloat E)
+    {
+        GLfloat bx = B * x;
+        return approxSin(C * approxAtan(bx - E * (bx - approxAtan(bx))));
+    }
+
+#ifdef TYREMODEL_SSE
+    //////////////////////////////////////////
+    // approximations of atan and sin, and Magic Formula (SSE versions, same formulas of the scalar ones)
+    static __m128 atan4(__m128 x)
+    {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 xSign = _mm_and_ps(x, sign);
+        __m128 a = _mm_andnot_ps(sign, x);
+        __m128 inverse = _mm_cmpgt_ps(a, one);
+        // t = inverse ? 1/a : a
+        __m128 t = _mm_or_ps(_mm_and_ps(inverse, _mm_div_ps(one, _mm_max_ps(a, one))), _mm_andnot_ps(inverse, a));
+        __m128 poly = _mm_add_ps(_mm_set1_ps(0.2447f), _mm_mul_ps(_mm_set1_ps(0.0663f), t));
+        __m128 r = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(0.7853982f), t), _mm_mul_ps(_mm_mul_ps(t, _mm_sub_ps(t, one)), poly));
+        r = _mm_or_ps(_mm_and_ps(inverse, _mm_sub_ps(_mm_set1_ps(1.5707963f), r)), _mm_andnot_ps(inverse, r));
+        return _mm_or_ps(r, xSign);
+    }
+
+    static __m128 sin4(__m128 x)
+    {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(1.2732395f), x), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.4052847f), x), _mm_andnot_ps(sign, x)));
+        return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.225f), _mm_sub_ps(_mm_mul_ps(y, _mm_andnot_ps(sign, y)), y)), y);
+    }
+
+    static __m128 magic4(__m128 x, __m128 B, __m128 C, __m128 E)
+    {
+        __m128 bx = _mm_mul_ps(B, x);
+        return sin4(_mm_mul_ps(C, atan4(_mm_sub_ps(bx, _mm_mul_ps(E, _mm_sub_ps(bx, atan4(bx)))))));
+    }
+#endif
+};
@@ -0,0 +1,476 @@
+/*
+Vehicle class - v1
+- creation of the rigid body rig of a car: chassis (box), 4 wheels (cylinders), 4 suspensions (6DOF spring constraints)
+- despawn and respawn of the rig during the simulation
+- sleep policy: a parked vehicle is deactivated by Bullet, the vehicle controlled by the player is always active
+- per-vehicle settings used by the systems updated at each physics tick (e.g., TyreModel class)
+- control inputs of the driver (steering, handbrake, get up and jump impulses), applied at each physics tick
+- drivetrain (see Drivetrain class) applying the engine torque to the wheels
+- brakes, with anti-lock braking and traction control (see Brakes class)
+- aerodynamic drag and downforce (see Aerodynamics class)
+
+The control inputs are set by the game loop at each frame, and they are applied by ApplyControls at each physics tick (Bullet can run several ticks in a frame, or none): the steering moves towards the requested position at steeringSpeed, so it does not depend on the frame rate, and the get up and jump impulses are applied once, at the first tick after the request.
+The drive torque of each wheel is applied around the wheel axis, and the opposite torque is applied to the chassis (so the chassis pitches under acceleration).
+The brake torque is applied in the same way, against the spin of the wheel: it is limited to the torque which stops the wheel in one tick, so the brakes can never make the wheel spin backwards.
+Forces and torques are applied as impulses (force * time step) at each tick: the forces applied to a body are cleared by Bullet only at the end of stepSimulation, so forces applied at each internal tick would add up over the substeps of a frame.
+The drag is applied to the center of mass of the chassis, and the downforce of each axle in the middle of the axle (between the suspension points of its wheels).
+
+With many vehicles, the VehicleStore class updates all of them in a batch, with their inputs and state in arrays: it replaces ApplyControls, UpdateDrivetrain and UpdateAerodynamics.
+
+The chassis and the wheels have a pointer to their Vehicle as user pointer, so the systems scanning the contacts of the dynamics world can find the vehicle (and the wheel) involved in a contact without any search. The wheels also have the tyre type as user index (see FrictionTable class).
+
+Respawn moves a spawned rig to a new position in place (bodies, constraints and shapes are reused, velocities and state of drivetrain and brakes are reset), or it creates the rig again after Despawn, with the parameters of the constructor. Despawn removes bodies and constraints from the simulation and gives them back to the pools of the Physics class, so vehicles can be despawned and respawned (e.g., traffic, or successive scenarios) without allocations after the first ones.
+
+A vehicle which is not controlled by the player can sleep: when all its bodies stay below the sleeping thresholds (sleepLinear in m/s, sleepAngular in rad/s) for the deactivation time of Bullet (2 seconds), the island of the rig is deactivated, and the solver and the integration skip it. The systems updated at each tick skip the sleeping vehicles too. A sleeping vehicle wakes up:
+- on input: ApplyControls wakes it when throttle, steering, get up or jump are requested
+- on contact: Bullet wakes the island when an active body touches it (e.g., another car)
+- on request: Wake (e.g., from a script), and Respawn
+The controlled vehicle has the deactivation disabled (see SetControlled), so it never sleeps, even when it stops.
+
+N.B. 1) the front wheels can steer (angular limits around the y axis of the suspension), the rear wheels cannot
+N.B. 2) a despawned vehicle must be removed from the list of vehicles updated by the systems at each tick
+N.B. 3) the destructor despawns the vehicle: vehicles must be deleted before the Physics simulation is cleared or reset
+*/
+
+#pragma once
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+
+#include <utils/Physics.hpp>
+#include <utils/Friction.hpp>
+#include <utils/Drivetrain.hpp>
+#include <utils/Brakes.hpp>
+#include <utils/Aerodynamics.hpp>
+
+///////////////////  Vehicle class ///////////////////////
+class Vehicle
+{
+public:
+    // rigid bodies and constraints of the rig
+    btRigidBody* chassis;
+    btRigidBody* wheels[WHEELS];
+    btGeneric6DofSpringConstraint* suspensions[WHEELS];
+    // radius of the wheels
+    GLfloat wheelRadius[WHEELS];
+    // friction coefficient of the tyres, as set by the user
+    GLfloat tyreFriction;
+    // true if the tyre forces are computed by the tyre model (the Bullet friction of the tyres is disabled)
+    bool tyreModel;
+    // index of the vehicle in the batches of the systems (set by the systems at each tick)
+    GLuint batchIndex;
+    // engine, gearbox, clutch and differentials
+    Drivetrain drivetrain;
+    // brakes, ABS and traction control
+    Brakes brakes;
+    // drag and downforce
+    Aerodynamics aero;
+    // position of the front and rear axles along the chassis (z in the chassis frame)
+    GLfloat frontAxle, rearAxle;
+    // control inputs: throttle in [-1, 1] (negative values drive in reverse), brake in [0, 1], steer in [-1, 1] (requested position of the steering), handbrake
+    GLfloat throttle;
+    GLfloat brake;
+    GLfloat steer;
+    bool handbrake;
+    // one-shot inputs, cleared when the impulse is applied
+    bool getUp, jump;
+    // steering: current position in [-1, 1], angle of the front wheels at full lock (rad), speed of the steering (1/s)
+    GLfloat steering;
+    GLfloat steeringAngle;
+    GLfloat steeringSpeed;
+    // get up (torque impulse around the forward axis) and jump (upwards impulse)
+    GLfloat getUpImpulse, jumpImpulse;
+    // drive and brake torque of each wheel at the last tick
+    GLfloat wheelTorque[WHEELS];
+    GLfloat brakeTorque[WHEELS];
+    // parameters of the rig (used when the rig is created again by Respawn)
+    GLfloat chassisMass, frontTyreMass, rearTyreMass;
+    GLfloat stiffness, damping, lowLim, upLim;
+    // true if the rig is in the simulation
+    bool spawned;
+    // true if the vehicle is controlled by the player (it never sleeps)
+    bool controlled;
+    // sleeping thresholds of the bodies of the rig (m/s, rad/s)
+    GLfloat sleepLinear, sleepAngular;
+
+    //////////////////////////////////////////
+    // constructor: we create the rig in the spawn position, and we add it to the simulation
+    Vehicle(Physics& simulation, glm::vec3 spawn, GLfloat chassisMass, GLfloat frontTyreMass, GLfloat rearTyreMass, GLfloat tyreFriction, GLfloat stiffness, GLfloat damping, GLfloat lowLim, GLfloat upLim)
+        : simulation(simulation)
+    {
+        this->tyreFriction = tyreFriction;
+        this->tyreModel = false;
+        this->batchIndex = 0;
+        this->steeringAngle = 0.5f;
+        this->steeringSpeed = 3.0f;
+        this->getUpImpulse = 12000.0f;
+        this->jumpImpulse = 10000.0f;
+        this->chassisMass = chassisMass;
+        this->frontTyreMass = frontTyreMass;
+        this->rearTyreMass = rearTyreMass;
+        this->stiffness = stiffness;
+        this->damping = damping;
+        this->lowLim = lowLim;
+        this->upLim = upLim;
+        this->spawned = false;
+        this->controlled = false;
+        this->sleepLinear = 0.3f;
+        this->sleepAngular = 0.5f;
+        this->resetState();
+        this->create(spawn);
+    }
+
+    // destructor: the rig is removed from the simulation
+    ~Vehicle()
+    {
+        this->Despawn();
+    }
+
+    //////////////////////////////////////////
+    // we move the vehicle to the spawn position, at rest, with the given heading (rad around the y axis)
+    // if the rig is in the simulation, it is moved in place, otherwise it is created again
+    void Respawn(glm::vec3 spawn, GLfloat heading = 0.0f)
+    {
+        this->resetState();
+        if (!this->spawned) {
+            this->create(spawn);
+            if (heading == 0.0f)
+                return;
+        }
+
+        btTransform base;
+        base.setIdentity();
+        base.setRotation(btQuaternion(heading, 0.0f, 0.0f));
+        base.setOrigin(btVector3(spawn.x, spawn.y + 1.0f, spawn.z));
+        this->place(this->chassis, base);
+        for (GLuint i = 0; i < WHEELS; i++) {
+            GLfloat side = (this->wheelOffsets[i].x < 0.0f) ? -1.0f : 1.0f;
+            btTransform local;
+            local.setIdentity();
+            local.setRotation(btQuaternion(0.0f, 0.0f, glm::radians(90.0f * side)));
+            local.setOrigin(btVector3(this->wheelOffsets[i].x, this->wheelOffsets[i].y, this->wheelOffsets[i].z));
+            this->place(this->wheels[i], base * local);
+        }
+    }
+
+    // we remove the rig from the simulation (bodies and constraints go back to the pools)
+    void Despawn()
+    {
+        if (!this->spawned)
+            return;
+        for (GLuint i = 0; i < WHEELS; i++)
+            this->simulation.deleteConstraint(this->suspensions[i]);
+        for (GLuint i = 0; i < WHEELS; i++)
+            this->simulation.deleteRigidBody(this->wheels[i]);
+        this->simulation.deleteRigidBody(this->chassis);
+        this->chassis = NULL;
+        for (GLuint i = 0; i < WHEELS; i++) {
+            this->wheels[i] = NULL;
+            this->suspensions[i] = NULL;
+        }
+        this->spawned = false;
+    }
+
+    //////////////////////////////////////////
+    // the controlled vehicle never sleeps, the other ones sleep when they are idle
+    void SetControlled(bool enabled)
+    {
+        this->controlled = enabled;
+        if (this->spawned)
+            this->applySleepPolicy();
+    }
+
+    // true if the rig has been deactivated by Bullet
+    bool Sleeping() const
+    {
+        return !this->chassis->isActive();
+    }
+
+    // we wake up all the bodies of the rig (the deactivation timers start again)
+    void Wake()
+    {
+        this->chassis->activate(true);
+        for (GLuint i = 0; i < WHEELS; i++)
+            this->wheels[i]->activate(true);
+    }
+
+    //////////////////////////////////////////
+    // index of the wheel corresponding to the body (-1 if the body is not a wheel of the vehicle)
+    int WheelIndex(const btCollisionObject* body) const
+    {
+        for (int i = 0; i < WHEELS; i++)
+            if (this->wheels[i] == body)
+                return i;
+        return -1;
+    }
+
+    //////////////////////////////////////////
+    // we change the friction coefficient of the tyres (the Bullet friction is updated only if the tyre model is disabled)
+    void SetTyreFriction(GLfloat friction)
+    {
+        this->tyreFriction = friction;
+        if (!this->tyreModel)
+            for (GLuint i = 0; i < WHEELS; i++)
+                this->wheels[i]->setFriction(friction);
+    }
+
+    // we enable or disable the tyre model: when it is enabled, the friction of the tyres in the contacts computed by Bullet is 0
+    void EnableTyreModel(bool enabled)
+    {
+        this->tyreModel = enabled;
+        for (GLuint i = 0; i < WHEELS; i++)
+            this->wheels[i]->setFriction(enabled ? 0.0f : this->tyreFriction);
+    }
+
+    //////////////////////////////////////////
+    // spin of the wheel around its axis, relative to the chassis (rad/s, positive when the car moves forward)
+    GLfloat WheelSpin(GLuint i) const
+    {
+        btVector3 axis = this->chassis->getWorldTransform().getBasis().getColumn(0);
+        return -(this->wheels[i]->getAngularVelocity() - this->chassis->getAngularVelocity()).dot(axis);
+    }
+
+    // speed of the chassis along its forward direction (m/s, the car points towards -z)
+    GLfloat ForwardSpeed() const
+    {
+        btVector3 forward = -this->chassis->getWorldTransform().getBasis().getColumn(2);
+        return this->chassis->getLinearVelocity().dot(forward);
+    }
+
+    // inertia of the wheel around its axis (the y axis of the cylinder)
+    GLfloat WheelInertia(GLuint i) const
+    {
+        return 1.0f / this->wheels[i]->getInvInertiaDiagLocal().y();
+    }
+
+    //////////////////////////////////////////
+    // we apply the control inputs: steering and handbrake (angular limits of the suspensions), get up and jump impulses
+    void ApplyControls(GLfloat dt)
+    {
+        // a sleeping vehicle wakes up only when the driver requests something
+        if (this->Sleeping()) {
+            if (!HasInput(this->throttle, this->steer, this->steering, this->getUp, this->jump))
+                return;
+            this->Wake();
+        }
+
+        this->steering = SteeringStep(this->steering, this->steer, this->steeringSpeed, dt);
+        this->SetSuspensionLimits(this->steering, this->handbrake);
+        this->ApplyImpulses(this->getUp, this->jump);
+        this->getUp = this->jump = false;
+    }
+
+    //////////////////////////////////////////
+    // we update drivetrain and brakes, and we apply the drive and brake torques to the wheels (and the reaction to the chassis)
+    void UpdateDrivetrain(GLfloat dt)
+    {
+        if (this->Sleeping())
+            return;
+        GLfloat spin[WHEELS], total[WHEELS];
+        for (GLuint i = 0; i < WHEELS; i++)
+            spin[i] = this->WheelSpin(i);
+        this->drivetrain.Step(spin, this->throttle, this->handbrake, dt, this->wheelTorque);
+        this->brakes.Step(spin, this->wheelRadius, this->ForwardSpeed(), this->brake, dt, this->wheelTorque, this->brakeTorque);
+        for (GLuint i = 0; i < WHEELS; i++)
+            total[i] = BrakedTorque(this->wheelTorque[i], this->brakeTorque[i], spin[i], this->WheelInertia(i), dt);
+        this->ApplyWheelTorques(total, dt);
+    }
+
+    //////////////////////////////////////////
+    // we apply drag and downforce to the chassis
+    void UpdateAerodynamics(GLfloat dt)
+    {
+        if (this->Sleeping())
+            return;
+        GLfloat speed = this->chassis->getLinearVelocity().length();
+        GLfloat forwardSpeed = this->ForwardSpeed();
+        this->ApplyAeroForces(speed, this->aero.Drag(speed), this->aero.Downforce(forwardSpeed, true), this->aero.Downforce(forwardSpeed, false), dt);
+    }
+
+    //////////////////////////////////////////
+    // steps of the systems, shared by the methods above and by the batch update of the VehicleStore class (which computes the values in arrays)
+
+    // true if the inputs require the vehicle to be awake
+    static bool HasInput(GLfloat throttle, GLfloat steer, GLfloat steering, bool getUp, bool jump)
+    {
+        return throttle != 0.0f || steer != steering || getUp || jump;
+    }
+
+    // position of the steering after a tick: it moves towards the requested position at steeringSpeed
+    static GLfloat SteeringStep(GLfloat steering, GLfloat steer, GLfloat steeringSpeed, GLfloat dt)
+    {
+        GLfloat step = steeringSpeed * dt;
+        return steering + glm::clamp(steer - steering, -step, step);
+    }
+
+    // total torque of a wheel: the brake torque is applied against the spin, and it stops the wheel at most
+    static GLfloat BrakedTorque(GLfloat driveTorque, GLfloat brakeTorque, GLfloat spin, GLfloat inertia, GLfloat dt)
+    {
+        GLfloat braking = glm::min(brakeTorque, inertia * glm::abs(spin) / dt);
+        return driveTorque - ((spin > 0.0f) ? braking : -braking);
+    }
+
+    // angular limits of the suspensions: steering of the front wheels, and the handbrake locks the rear wheels
+    void SetSuspensionLimits(GLfloat steeringPosition, bool handbrakeOn)
+    {
+        GLfloat angle = this->steeringAngle * steeringPosition;
+        for (GLuint i = WHEEL_FL; i <= WHEEL_FR; i++) {
+            this->suspensions[i]->setAngularLowerLimit(btVector3(1, angle, 0));
+            this->suspensions[i]->setAngularUpperLimit(btVector3(-1, angle, 0));
+        }
+        GLfloat free = handbrakeOn ? 0.0f : 1.0f;
+        for (GLuint i = WHEEL_RL; i <= WHEEL_RR; i++) {
+            this->suspensions[i]->setAngularLowerLimit(btVector3(free, 0, 0));
+            this->suspensions[i]->setAngularUpperLimit(btVector3(-free, 0, 0));
+        }
+    }
+
+    // one-shot impulses: get up (turns the car around its forward axis), jump
+    void ApplyImpulses(bool getUpOn, bool jumpOn)
+    {
+        if (getUpOn) {
+            btMatrix3x3 rot = this->chassis->getWorldTransform().getBasis();
+            this->chassis->applyTorqueImpulse(rot * btVector3(0, 0, this->getUpImpulse));
+        }
+        if (jumpOn)
+            this->chassis->applyCentralImpulse(btVector3(0, this->jumpImpulse, 0));
+    }
+
+    // we apply the total torques to the wheels, and their reaction to the chassis
+    void ApplyWheelTorques(const GLfloat total[WHEELS], GLfloat dt)
+    {
+        btMatrix3x3 rot = this->chassis->getWorldTransform().getBasis();
+        btVector3 reaction(0.0f, 0.0f, 0.0f);
+        for (GLuint i = 0; i < WHEELS; i++) {
+            btVector3 torque = rot * btVector3(-total[i], 0, 0);
+            this->wheels[i]->applyTorqueImpulse(torque * dt);
+            reaction -= torque;
+        }
+        this->chassis->applyTorqueImpulse(reaction * dt);
+    }
+
+    // we apply the drag against the velocity (speed is its magnitude), and the downforce in the middle of the axles
+    void ApplyAeroForces(GLfloat speed, GLfloat drag, GLfloat frontDownforce, GLfloat rearDownforce, GLfloat dt)
+    {
+        if (speed < SIMD_EPSILON)
+            return;
+        btMatrix3x3 rot = this->chassis->getWorldTransform().getBasis();
+        this->chassis->applyCentralImpulse(-this->chassis->getLinearVelocity() / speed * drag * dt);
+        btVector3 down = -rot.getColumn(1);
+        this->chassis->applyImpulse(down * frontDownforce * dt, rot * btVector3(0, 0, this->frontAxle));
+        this->chassis->applyImpulse(down * rearDownforce * dt, rot * btVector3(0, 0, this->rearAxle));
+    }
+
+private:
+    Physics& simulation;
+    // position of the wheels with respect to the chassis
+    glm::vec3 wheelOffsets[WHEELS];
+
+    //////////////////////////////////////////
+    // inputs, drivetrain and brakes back to the initial state (the settings are kept)
+    void resetState()
+    {
+        this->throttle = 0.0f;
+        this->brake = 0.0f;
+        this->steer = 0.0f;
+        this->handbrake = false;
+        this->getUp = false;
+        this->jump = false;
+        this->steering = 0.0f;
+        for (GLuint i = 0; i < WHEELS; i++)
+            this->wheelTorque[i] = this->brakeTorque[i] = 0.0f;
+        this->drivetrain.Reset();
+        this->brakes.Reset();
+    }
+
+    //////////////////////////////////////////
+    // we place a body at rest in the given transform, and we remove its old contacts
+    void place(btRigidBody* body, const btTransform& transform)
+    {
+        body->setWorldTransform(transform);
+        body->setInterpolationWorldTransform(transform);
+        body->getMotionState()->setWorldTransform(transform);
+        body->setLinearVelocity(btVector3(0, 0, 0));
+        body->setAngularVelocity(btVector3(0, 0, 0));
+        body->setInterpolationLinearVelocity(btVector3(0, 0, 0));
+        body->setInterpolationAngularVelocity(btVector3(0, 0, 0));
+        body->clearForces();
+        body->activate(true);
+        btDynamicsWorld* world = this->simulation.dynamicsWorld;
+        world->getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(body->getBroadphaseHandle(), world->getDispatcher());
+    }
+
+    //////////////////////////////////////////
+    // we create the rig in the spawn position, and we add it to the simulation
+    void create(glm::vec3 spawn)
+    {
+        Physics& simulation = this->simulation;
+        glm::vec3 car_pos = glm::vec3(0.0f, 1.0f, 0.0f) + spawn;
+        glm::vec3 car_size = glm::vec3(1.0f, 0.6f, 3.0f);
+        glm::vec3 car_rot = glm::vec3(0.0f, 0.0f, 0.0f);
+        this->chassis = simulation.createRigidBody(BOX, car_pos, car_size, car_rot, this->chassisMass, 1.75f, 0.2f, COLL_CHASSIS, COLL_EVERYTHING^COLL_CAR);
+        this->chassis->setUserPointer(this);
+
+        // position of the wheels with respect to the chassis, and size of the cylinders
+        glm::vec3 offsets[WHEELS] = { glm::vec3(-1.0f, -0.5f, -2.1f), glm::vec3(1.0f, -0.5f, -2.1f), glm::vec3(-1.0f, -0.5f, 1.6f), glm::vec3(1.0f, -0.5f, 1.6f) };
+        glm::vec3 sizes[WHEELS] = { glm::vec3(0.4f, 0.35f, 0.35f), glm::vec3(0.4f, 0.35f, 0.35f), glm::vec3(0.45f, 0.4f, 0.4f), glm::vec3(0.45f, 0.4f, 0.4f) };
+        this->frontAxle = offsets[WHEEL_FL].z;
+        this->rearAxle = offsets[WHEEL_RL].z;
+
+        btTransform frameA, frameB;
+        for (GLuint i = 0; i < WHEELS; i++) {
+            bool front = (i == WHEEL_FL || i == WHEEL_FR);
+            // left wheels are rotated by -90 degrees, right wheels by 90 degrees
+            GLfloat side = (offsets[i].x < 0.0f) ? -1.0f : 1.0f;
+            this->wheelOffsets[i] = offsets[i];
+
+            glm::vec3 t_pos = offsets[i] + glm::vec3(0.0f, 1.0f, 0.0f) + spawn;
+            glm::vec3 t_rot = glm::vec3(0.0f, 0.0f, glm::radians(90.0f * side));
+            this->wheels[i] = simulation.createRigidBody(CYLINDER, t_pos, sizes[i], t_rot, front ? this->frontTyreMass : this->rearTyreMass, this->tyreModel ? 0.0f : this->tyreFriction, 0.0f, COLL_TYRE, COLL_EVERYTHING^COLL_CAR);
+            this->wheels[i]->setUserPointer(this);
+            this->wheels[i]->setUserIndex(TYRE_ROAD);    // friction from the tyre/surface table
+            // the radius of a cylinder along the y axis is its x half extent
+            this->wheelRadius[i] = sizes[i].x;
+
+            frameA = btTransform::getIdentity();
+            frameB = btTransform::getIdentity();
+            frameA.getBasis().setEulerZYX(0, 0, 0);
+            frameB.getBasis().setEulerZYX(0, 0, glm::radians(-90.0f * side));
+            frameA.setOrigin(btVector3(offsets[i].x, offsets[i].y, offsets[i].z));
+            frameB.setOrigin(btVector3(0.0, 0.0, 0.0));
+            btGeneric6DofSpringConstraint* c = simulation.createSpringConstraint(*this->chassis, *this->wheels[i], frameA, frameB);
+            c->setLinearLowerLimit(btVector3(0, -this->lowLim, 0));
+            c->setLinearUpperLimit(btVector3(0, -this->upLim, 0));
+            if (front) {
+                c->setAngularLowerLimit(btVector3(1, -0.5, 0));
+                c->setAngularUpperLimit(btVector3(-1, 0.5, 0));
+            } else {
+                c->setAngularLowerLimit(btVector3(1, 0, 0));
+                c->setAngularUpperLimit(btVector3(-1, 0, 0));
+            }
+            c->enableSpring(1, true);
+            c->setStiffness(1, this->stiffness);
+            c->setDamping(1, this->damping);
+            c->setEquilibriumPoint();
+            this->suspensions[i] = c;
+        }
+
+        for (GLuint i = 0; i < WHEELS; i++)
+            simulation.dynamicsWorld->addConstraint(this->suspensions[i]);
+        this->spawned = true;
+        this->applySleepPolicy();
+    }
+
+    //////////////////////////////////////////
+    // thresholds and activation state of the bodies of the rig: the controlled vehicle never sleeps
+    void applySleepPolicy()
+    {
+        btRigidBody* bodies[WHEELS + 1] = { this->chassis, this->wheels[WHEEL_FL], this->wheels[WHEEL_FR], this->wheels[WHEEL_RL], this->wheels[WHEEL_RR] };
+        for (GLuint i = 0; i < WHEELS + 1; i++) {
+            bodies[i]->setSleepingThresholds(this->sleepLinear, this->sleepAngular);
+            bodies[i]->forceActivationState(this->controlled ? DISABLE_DEACTIVATION : ACTIVE_TAG);
+            bodies[i]->setDeactivationTime(0.0f);
+        }
+    }
+};
@@ -0,0 +1,288 @@
+/*
+VehicleStore class - v1
+- per-vehicle inputs, tuning parameters and derived quantities (speed, wheel spin, slip, torques) in contiguous arrays (structure of arrays)
+- update of all the vehicles at each physics tick, in phases: gather from Bullet, batch kernels, synchronization to Bullet
+
+The Vehicle class keeps the rig (bodies and constraints) and the systems with internal state (Drivetrain, Brakes); its methods ApplyControls, UpdateDrivetrain and UpdateAerodynamics update one vehicle at a time, reading the Bullet objects at each step. With hundreds of vehicles, the store replaces them with a single update:
+1) gather: a single pass over the vehicles reads velocities from Bullet, and computes speed, forward speed and spin of the wheels
+2) kernels: steering and slips of the wheels are computed with loops over arrays of floats, with no pointers and no branches on the data, which the compiler can vectorize
+3) drivetrain and brakes: the Drivetrain and Brakes objects of each vehicle read spins and slips of its wheels, and write the torques, directly in the arrays of the store
+4) kernels: total torques of the wheels (brake limits), and aerodynamic forces
+5) scatter: a single pass over the vehicles writes everything to Bullet (constraint limits, impulses), and copies steering and torques back to the Vehicle
+
+The store does not have its own copy of the physics of the vehicles: the kernels and the scatter call the same steps used by the methods of the Vehicle class (e.g., Vehicle::WheelSpin, Vehicle::SteeringStep, Brakes::Slip, Vehicle::BrakedTorque, Vehicle::ApplyWheelTorques), so the two paths cannot drift apart.
+
+The per-wheel arrays have WHEELS elements for each vehicle (index = vehicle * WHEELS + wheel).
+The tuning parameters are copied from the Vehicle when it is added: SyncTuning must be called after a change of the settings of a vehicle (e.g., steering angle, aerodynamic coefficients, mass of the wheels).
+
+N.B. 1) the results are the same of the methods of the Vehicle class, including the sleep policy (sleeping vehicles wake up on input, and they are skipped otherwise); the only difference is at the tick of a get up or jump impulse, whose effect on the velocities is read by the drivetrain at the next tick
+N.B. 2) the inputs of the vehicles in the store are the ones of the store: the input fields of the Vehicle class are not used
+N.B. 3) the tyre forces are computed by the TyreModel class, on the list of vehicles of the store
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+
+// GL Includes
+#include <glad/glad.h> // Contains all the necessery OpenGL includes
+#include <glm/glm.hpp>
+
+#include <utils/Physics.hpp>
+#include <utils/Vehicle.hpp>
+
+///////////////////  VehicleStore class ///////////////////////
+class VehicleStore
+{
+public:
+    // the vehicles of the store (the store does not own them)
+    vector<Vehicle*> vehicles;
+
+    // inputs (see Vehicle class): throttle in [-1, 1], brake in [0, 1], steer in [-1, 1], handbrake, one-shot get up and jump
+    vector<GLfloat> throttle, brake, steer;
+    vector<unsigned char> handbrake, getUp, jump;
+
+    // tuning parameters, copied from the vehicles
+    vector<GLfloat> steeringAngle, steeringSpeed;
+    vector<GLfloat> dragFactor, frontDownforceFactor, rearDownforceFactor;   // 1/2 * rho * C * A
+    vector<GLfloat> minSpeed;                                               // reference speed of the slips (see Brakes class)
+    vector<GLfloat> wheelRadius, wheelInertia;                              // per wheel
+
+    // state and derived quantities, updated at each tick
+    vector<GLfloat> steering;
+    vector<unsigned char> awake;
+    vector<GLfloat> speed, forwardSpeed;
+    vector<GLfloat> drag, frontDownforce, rearDownforce;
+    vector<GLfloat> wheelSpin, slip, wheelTorque, brakeTorque, totalTorque;    // per wheel
+
+    //////////////////////////////////////////
+    // number of vehicles in the store
+    GLuint Count() const
+    {
+        return this->vehicles.size();
+    }
+
+    //////////////////////////////////////////
+    // we add a vehicle at the end of the arrays, and we return its index
+    GLuint Add(Vehicle* vehicle)
+    {
+        GLuint i = this->vehicles.size();
+        this->vehicles.push_back(vehicle);
+        this->resize(i + 1);
+        this->clearInputs(i);
+        this->SyncTuning(i);
+        return i;
+    }
+
+    // we remove a vehicle: the last vehicle takes its index
+    void Remove(GLuint i)
+    {
+        GLuint last = this->vehicles.size() - 1;
+        if (i != last)
+            this->move(last, i);
+        this->vehicles.pop_back();
+        this->resize(last);
+    }
+
+    //////////////////////////////////////////
+    // we copy the tuning parameters of a vehicle in the arrays
+    void SyncTuning(GLuint i)
+    {
+        Vehicle* vehicle = this->vehicles[i];
+        const Aerodynamics& aero = vehicle->aero;
+        this->steeringAngle[i] = vehicle->steeringAngle;
+        this->steeringSpeed[i] = vehicle->steeringSpeed;
+        this->dragFactor[i] = aero.DragFactor();
+        this->frontDownforceFactor[i] = aero.DownforceFactor(true);
+        this->rearDownforceFactor[i] = aero.DownforceFactor(false);
+        this->minSpeed[i] = vehicle->brakes.minSpeed;
+        for (GLuint w = 0; w < WHEELS; w++) {
+            this->wheelRadius[i * WHEELS + w] = vehicle->wheelRadius[w];
+            this->wheelInertia[i * WHEELS + w] = vehicle->WheelInertia(w);
+        }
+    }
+
+    //////////////////////////////////////////
+    // we move a vehicle to the spawn position, at rest (see Vehicle class), and we clear its inputs
+    void Respawn(GLuint i, glm::vec3 spawn, GLfloat heading = 0.0f)
+    {
+        this->vehicles[i]->Respawn(spawn, heading);
+        this->clearInputs(i);
+        this->SyncTuning(i);
+    }
+
+    //////////////////////////////////////////
+    // we update all the vehicles (called at each physics tick)
+    void Update(GLfloat dt)
+    {
+        GLuint n = this->vehicles.size();
+        for (GLuint i = 0; i < n; i++)
+            this->gather(i);
+
+        this->steeringKernel(n, dt);
+        this->slipKernel(n);
+        for (GLuint i = 0; i < n; i++)
+            this->drivetrain(i, dt);
+        this->torqueKernel(n * WHEELS, dt);
+        this->aeroKernel(n);
+
+        for (GLuint i = 0; i < n; i++)
+            this->scatter(i, dt);
+    }
+
+private:
+    //////////////////////////////////////////
+    // we resize all the arrays for n vehicles
+    void resize(GLuint n)
+    {
+        vector<GLfloat>* floats[] = { &this->throttle, &this->brake, &this->steer, &this->steeringAngle, &this->steeringSpeed,
+            &this->dragFactor, &this->frontDownforceFactor, &this->rearDownforceFactor, &this->minSpeed,
+            &this->steering, &this->speed, &this->forwardSpeed, &this->drag, &this->frontDownforce, &this->rearDownforce };
+        for (GLuint k = 0; k < sizeof(floats) / sizeof(floats[0]); k++)
+            floats[k]->resize(n, 0.0f);
+        vector<GLfloat>* wheels[] = { &this->wheelRadius, &this->wheelInertia, &this->wheelSpin, &this->slip, &this->wheelTorque, &this->brakeTorque, &this->totalTorque };
+        for (GLuint k = 0; k < sizeof(wheels) / sizeof(wheels[0]); k++)
+            wheels[k]->resize(n * WHEELS, 0.0f);
+        this->handbrake.resize(n, 0);
+        this->getUp.resize(n, 0);
+        this->jump.resize(n, 0);
+        this->awake.resize(n, 0);
+    }
+
+    // we copy the data of the vehicle with index "from" in the index "to"
+    void move(GLuint from, GLuint to)
+    {
+        this->vehicles[to] = this->vehicles[from];
+        vector<GLfloat>* floats[] = { &this->throttle, &this->brake, &this->steer, &this->steeringAngle, &this->steeringSpeed,
+            &this->dragFactor, &this->frontDownforceFactor, &this->rearDownforceFactor, &this->minSpeed,
+            &this->steering, &this->speed, &this->forwardSpeed, &this->drag, &this->frontDownforce, &this->rearDownforce };
+        for (GLuint k = 0; k < sizeof(floats) / sizeof(floats[0]); k++)
+            (*floats[k])[to] = (*floats[k])[from];
+        vector<GLfloat>* wheels[] = { &this->wheelRadius, &this->wheelInertia, &this->wheelSpin, &this->slip, &this->wheelTorque, &this->brakeTorque, &this->totalTorque };
+        for (GLuint k = 0; k < sizeof(wheels) / sizeof(wheels[0]); k++)
+            for (GLuint w = 0; w < WHEELS; w++)
+                (*wheels[k])[to * WHEELS + w] = (*wheels[k])[from * WHEELS + w];
+        this->handbrake[to] = this->handbrake[from];
+        this->getUp[to] = this->getUp[from];
+        this->jump[to] = this->jump[from];
+        this->awake[to] = this->awake[from];
+    }
+
+    // inputs and steering back to rest
+    void clearInputs(GLuint i)
+    {
+        this->throttle[i] = this->brake[i] = this->steer[i] = 0.0f;
+        this->handbrake[i] = this->getUp[i] = this->jump[i] = 0;
+        this->steering[i] = 0.0f;
+    }
+
+    //////////////////////////////////////////
+    // gather: we wake up the sleeping vehicles with inputs, and we read velocities and spins of the awake ones
+    void gather(GLuint i)
+    {
+        Vehicle* vehicle = this->vehicles[i];
+        if (vehicle->Sleeping()) {
+            if (!Vehicle::HasInput(this->throttle[i], this->steer[i], this->steering[i], this->getUp[i], this->jump[i])) {
+                this->awake[i] = 0;
+                return;
+            }
+            vehicle->Wake();
+        }
+        this->awake[i] = 1;
+
+        this->speed[i] = vehicle->chassis->getLinearVelocity().length();
+        this->forwardSpeed[i] = vehicle->ForwardSpeed();
+        for (GLuint w = 0; w < WHEELS; w++)
+            this->wheelSpin[i * WHEELS + w] = vehicle->WheelSpin(w);
+    }
+
+    //////////////////////////////////////////
+    // steering: it moves towards the requested position at steeringSpeed
+    void steeringKernel(GLuint n, GLfloat dt)
+    {
+        const GLfloat* steer = this->steer.data();
+        const GLfloat* rate = this->steeringSpeed.data();
+        GLfloat* steering = this->steering.data();
+        for (GLuint i = 0; i < n; i++)
+            steering[i] = Vehicle::SteeringStep(steering[i], steer[i], rate[i], dt);
+    }
+
+    // slip ratio of each wheel (read by the Brakes of the vehicle)
+    void slipKernel(GLuint n)
+    {
+        const GLfloat* spin = this->wheelSpin.data();
+        const GLfloat* radius = this->wheelRadius.data();
+        GLfloat* slip = this->slip.data();
+        for (GLuint i = 0; i < n; i++)
+            for (GLuint w = 0; w < WHEELS; w++)
+                slip[i * WHEELS + w] = Brakes::Slip(spin[i * WHEELS + w], radius[i * WHEELS + w], this->forwardSpeed[i], this->minSpeed[i]);
+    }
+
+    //////////////////////////////////////////
+    // drivetrain and brakes of a vehicle: the torques are written directly in the arrays (no torques for the sleeping vehicles)
+    void drivetrain(GLuint i, GLfloat dt)
+    {
+        GLuint base = i * WHEELS;
+        if (!this->awake[i]) {
+            for (GLuint w = 0; w < WHEELS; w++)
+                this->wheelTorque[base + w] = this->brakeTorque[base + w] = 0.0f;
+            return;
+        }
+        Vehicle* vehicle = this->vehicles[i];
+        vehicle->drivetrain.Step(&this->wheelSpin[base], this->throttle[i], this->handbrake[i] != 0, dt, &this->wheelTorque[base]);
+        vehicle->brakes.Step(&this->slip[base], this->forwardSpeed[i], this->brake[i], dt, &this->wheelTorque[base], &this->brakeTorque[base]);
+    }
+
+    // torque of each wheel: the brake torque is applied against the spin, and it stops the wheel at most
+    void torqueKernel(GLuint count, GLfloat dt)
+    {
+        const GLfloat* spin = this->wheelSpin.data();
+        const GLfloat* drive = this->wheelTorque.data();
+        const GLfloat* brake = this->brakeTorque.data();
+        const GLfloat* inertia = this->wheelInertia.data();
+        GLfloat* total = this->totalTorque.data();
+        for (GLuint k = 0; k < count; k++)
+            total[k] = Vehicle::BrakedTorque(drive[k], brake[k], spin[k], inertia[k], dt);
+    }
+
+    // magnitudes of drag and downforce (see Aerodynamics class)
+    void aeroKernel(GLuint n)
+    {
+        const GLfloat* speed = this->speed.data();
+        const GLfloat* forward = this->forwardSpeed.data();
+        for (GLuint i = 0; i < n; i++) {
+            this->drag[i] = this->dragFactor[i] * speed[i] * speed[i];
+            this->frontDownforce[i] = this->frontDownforceFactor[i] * forward[i] * forward[i];
+            this->rearDownforce[i] = this->rearDownforceFactor[i] * forward[i] * forward[i];
+        }
+    }
+
+    //////////////////////////////////////////
+    // scatter: we write the results of a vehicle to Bullet (constraint limits and impulses), and to the Vehicle
+    void scatter(GLuint i, GLfloat dt)
+    {
+        if (!this->awake[i])
+            return;
+        Vehicle* vehicle = this->vehicles[i];
+        GLuint base = i * WHEELS;
+
+        // steering and handbrake, one-shot impulses
+        vehicle->steeringAngle = this->steeringAngle[i];
+        vehicle->SetSuspensionLimits(this->steering[i], this->handbrake[i] != 0);
+        vehicle->ApplyImpulses(this->getUp[i] != 0, this->jump[i] != 0);
+        this->getUp[i] = this->jump[i] = 0;
+
+        // drive and brake torques (and their reaction on the chassis), drag and downforce
+        vehicle->ApplyWheelTorques(&this->totalTorque[base], dt);
+        for (GLuint w = 0; w < WHEELS; w++) {
+            vehicle->wheelTorque[w] = this->wheelTorque[base + w];
+            vehicle->brakeTorque[w] = this->brakeTorque[base + w];
+        }
+        vehicle->ApplyAeroForces(this->speed[i], this->drag[i], this->frontDownforce[i], this->rearDownforce[i], dt);
+
+        vehicle->steering = this->steering[i];
+    }
+};
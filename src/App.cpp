@@ -1,5 +1,5 @@
 /*
-    g++ src/* -o App -I ./includes -lGL -lglfw -ldl -lassimp -I ./includes/bullet/ ./includes/bullet/BulletDynamics/libBulletDynamics.a ./includes/bullet/BulletCollision/libBulletCollision.a ./includes/bullet/LinearMath/libLinearMath.a
+    g++ src/* -o App -pthread -I ./includes -lGL -lglfw -ldl -lassimp -I ./includes/bullet/ ./includes/bullet/BulletDynamics/libBulletDynamics.a ./includes/bullet/BulletCollision/libBulletCollision.a ./includes/bullet/LinearMath/libLinearMath.a
 */
 
 #include <glad/glad.h>
@@ -13,10 +13,19 @@
 #include <utils/Camera.hpp>
 #include <utils/Model.hpp>
 #include <utils/Physics.hpp>
+#include <utils/Frustum.hpp>
+#include <utils/Track.hpp>
+#include <utils/Terrain.hpp>
+#include <utils/Heightfield.hpp>
+#include <utils/Vehicle.hpp>
+#include <utils/VehicleStore.hpp>
+#include <utils/TyreModel.hpp>
 
 #include <gtk/gtk.h>
 
 #include <iostream>
+#include <string>
+#include <cstring>
 
 const unsigned int SCR_WIDTH    = 960;
 const unsigned int SCR_HEIGHT   = 540;
@@ -39,9 +48,13 @@ void preset0_callback(GtkWidget *widget, gpointer callback_data);
 void preset1_callback(GtkWidget *widget, gpointer callback_data);
 void preset2_callback(GtkWidget *widget, gpointer callback_data);
 void preset3_callback(GtkWidget *widget, gpointer callback_data);
+void tyremodel_callback(GtkWidget *widget, gpointer callback_data);
+void abs_callback(GtkWidget *widget, gpointer callback_data);
+void tc_callback(GtkWidget *widget, gpointer callback_data);
 
 // Support functions
 void processInput(GLFWwindow* window);
+void physicsTick(btDynamicsWorld* world, btScalar timeStep);
 unsigned int loadCubeMap();
 
 // Camera controls
@@ -60,10 +73,11 @@ bool switched = FALSE;
 short acceleration = 0;
 float steering = 0.0f;
 bool handbrake = FALSE;
-float maxAcceleration = 800.0f;     // torque
-float maxVelocity = 50.0f;          // max limit
+float maxAcceleration = 800.0f;     // peak engine torque
+float maxVelocity = 50.0f;          // braking instead of reverse above maxVelocity/10
 bool getUp = FALSE, gotUp = FALSE;
 bool jump = FALSE, jumped = FALSE;
+bool respawn = FALSE, respawned = FALSE;
 float basePitch = 0.0f, baseYaw = 0.0f;
 
 // Car properties
@@ -86,6 +100,11 @@ const float tAngDamp = 0.2f;
 btRigidBody *car, *t1, *t2, *t3, *t4;
 btGeneric6DofSpringConstraint *c1, *c2, *c3, *c4;
 
+// Vehicles of the simulation (with their inputs and state in arrays, see VehicleStore class), and systems updated at each physics tick
+VehicleStore vehicleStore;
+GLuint player = 0;      // index of the car of the player in the store
+TyreModel tyreModel;
+
 // UI widgets
 GtkWidget *panel;
 GtkWidget *vgrid;
@@ -111,12 +130,29 @@ GtkWidget *preset0;
 GtkWidget *preset1;
 GtkWidget *preset2;
 GtkWidget *preset3;
+GtkWidget *tyremodel;
+GtkWidget *abs_check, *tc_check;
 
 // Delta time
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main() {
+// Frustum culling
+Frustum frustum;
+unsigned int frames = 0;
+float lastStats = 0.0f;
+
+int main(int argc, char** argv) {
+    // Command line options
+    const char* heightfieldPath = NULL;
+    const char* trackPath = "tracks/oval.txt";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--heightfield") == 0 && i + 1 < argc)
+            heightfieldPath = argv[++i];
+        else if (strcmp(argv[i], "--track") == 0 && i + 1 < argc)
+            trackPath = argv[++i];
+    }
+
     // Setup panel
     gtk_init(0, NULL);
 
@@ -207,6 +243,13 @@ int main() {
     preset2 = gtk_button_new_with_label("Pimp");
     preset3 = gtk_button_new_with_label("Sport");
 
+    tyremodel = gtk_check_button_new_with_label("Magic Formula tyre model");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(tyremodel), FALSE);
+    abs_check = gtk_check_button_new_with_label("ABS");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(abs_check), TRUE);
+    tc_check = gtk_check_button_new_with_label("Traction control");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(tc_check), TRUE);
+
     gtk_grid_attach(GTK_GRID(vgrid), mass_text, 0, 0, 4, 1);
     gtk_grid_attach(GTK_GRID(vgrid), mass, 0, 1, 4, 1);
     gtk_grid_attach(GTK_GRID(vgrid), stiffness_text, 0, 2, 4, 1);
@@ -230,6 +273,9 @@ int main() {
     gtk_grid_attach(GTK_GRID(vgrid), preset3, 2, 16, 2, 1);
 
     gtk_grid_remove_row(GTK_GRID(vgrid), 17);
+    gtk_grid_attach(GTK_GRID(vgrid), tyremodel, 0, 17, 4, 1);
+    gtk_grid_attach(GTK_GRID(vgrid), abs_check, 0, 18, 2, 1);
+    gtk_grid_attach(GTK_GRID(vgrid), tc_check, 2, 18, 2, 1);
 
     g_signal_connect(G_OBJECT(mass), "value-changed", G_CALLBACK(mass_callback), G_OBJECT(mass));
     g_signal_connect(G_OBJECT(stiffness), "value-changed", G_CALLBACK(stiffness_callback), G_OBJECT(stiffness));
@@ -242,6 +288,9 @@ int main() {
     g_signal_connect(G_OBJECT(preset1), "clicked", G_CALLBACK(preset1_callback), G_OBJECT(preset1));
     g_signal_connect(G_OBJECT(preset2), "clicked", G_CALLBACK(preset2_callback), G_OBJECT(preset2));
     g_signal_connect(G_OBJECT(preset3), "clicked", G_CALLBACK(preset3_callback), G_OBJECT(preset3));
+    g_signal_connect(G_OBJECT(tyremodel), "toggled", G_CALLBACK(tyremodel_callback), G_OBJECT(tyremodel));
+    g_signal_connect(G_OBJECT(abs_check), "toggled", G_CALLBACK(abs_callback), G_OBJECT(abs_check));
+    g_signal_connect(G_OBJECT(tc_check), "toggled", G_CALLBACK(tc_callback), G_OBJECT(tc_check));
 
     g_signal_connect(G_OBJECT(panel), "destroy", G_CALLBACK(gtk_main_quit), G_OBJECT(panel));
 
@@ -284,14 +333,14 @@ int main() {
 
     // Car
     Shader mShader("shaders/car.vert", "shaders/car.frag");
-    Model mModel((char*) "models/car/car.obj");
-    Model t1Model((char*) "models/car/tyref.obj");
-    Model t2Model((char*) "models/car/tyreb.obj");
+    Model* mModel = new Model((char*) "models/car/car.obj");
+    Model* t1Model = new Model((char*) "models/car/tyref.obj");
+    Model* t2Model = new Model((char*) "models/car/tyreb.obj");
 
     // Terrain
     Shader tShader("shaders/terrain.vert", "shaders/terrain.frag");
-    Model tModel0((char*) "models/terrain/grass.obj");
-    Model tModel1((char*) "models/terrain/asphalt.obj");
+    Model* tModel0 = new Model((char*) "models/terrain/grass.obj");
+    Model* tModel1 = new Model((char*) "models/terrain/asphalt.obj");
 
     // Skybox
     Shader sShader("shaders/skybox.vert", "shaders/skybox.frag");
@@ -339,14 +388,15 @@ int main() {
         -1.0f, -1.0f,  1.0f,
          1.0f, -1.0f,  1.0f
     };
-    unsigned int skyboxVAO, skyboxVBO;
-    glGenVertexArrays(1, &skyboxVAO);
-    glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    // the skybox cube is stored in the shared buffers too (only the positions are used by the shader)
+    vector<Vertex> skyboxMeshVertices(36);
+    vector<GLuint> skyboxMeshIndices(36);
+    for (unsigned int i = 0; i < 36; i++) {
+        skyboxMeshVertices[i] = Vertex();
+        skyboxMeshVertices[i].Position = glm::vec3(skyboxVertices[3*i], skyboxVertices[3*i+1], skyboxVertices[3*i+2]);
+        skyboxMeshIndices[i] = i;
+    }
+    Mesh skyboxMesh(std::move(skyboxMeshVertices), std::move(skyboxMeshIndices), vector<Texture>());
     unsigned int cubemapTexture = loadCubeMap();
 
     // Physics world
@@ -366,173 +416,64 @@ int main() {
     upLim = 0.1f;
 
     // Terrain
-    const unsigned int grid_width = 5;
-    const unsigned int grid_height = 8;
-    const unsigned int tiles = grid_width * grid_height;
-    const unsigned int track[grid_height][grid_width] = {
-        { 0, 0, 0, 0, 0 },
-        { 0, 1, 1, 1, 0 },
-        { 0, 1, 0, 1, 0 },
-        { 0, 1, 0, 1, 0 },
-        { 0, 1, 0, 1, 0 },
-        { 0, 1, 0, 1, 0 },
-        { 0, 1, 1, 1, 0 },
-        { 0, 0, 0, 0, 0 }
-    };
-    btRigidBody *plane[tiles];
-    glm::vec3 plane_pos[tiles];
-    glm::vec3 plane_size[tiles];
-    const float plane_edge = 20.0f;
-
-    for (unsigned int i = 0; i < grid_width; i++) {
-        for (unsigned int j = 0; j < grid_height; j++) {
-            plane_pos[i*(grid_height)+j] = glm::vec3(2*plane_edge*i - plane_edge*(grid_width-1), -0.0f*(i*(grid_height)+j), 2*plane_edge*j - plane_edge*(grid_height-1));
-            plane_size[i*(grid_height)+j] = glm::vec3(plane_edge, 0.0f, plane_edge);
-            //cout << i << ", " << j << ": " << i+j << ". " << i*(grid_height)+j << endl;
-            glm::vec3 plane_rot = glm::vec3(0.0f, 0.0f, 0.0f);
-            if (track[j][i] == 0) {
-                // Grass
-                plane[i*(grid_height)+j] = simulation.createRigidBody(BOX, plane_pos[i*(grid_height)+j], plane_size[i*(grid_height)+j], plane_rot, 0.0f, 0.25f, 0.25f, COLL_TERRAIN, COLL_EVERYTHING);
-            } else if (track[j][i] == 1) {
-                // Asphalt
-                plane[i*(grid_height)+j] = simulation.createRigidBody(BOX, plane_pos[i*(grid_height)+j] + glm::vec3(0.0f, 0.05f, 0.0f), plane_size[i*(grid_height)+j] + glm::vec3(0.0f, 0.05f, 0.0f), plane_rot, 0.0f, 0.5f, 0.5f, COLL_TERRAIN, COLL_EVERYTHING);
-            }
-
-        }
+    // tiles, materials, walls and spawn points are loaded from the track file (binary or text, see TrackFile class)
+    TrackFile trackFile;
+    if (!trackFile.Open(trackPath)) {
+        glfwTerminate();
+        return EXIT_FAILURE;
     }
-
-    // Invisible walls
-    const unsigned int walls = 4;
-    float side;
-    glm::vec3 wall_pos;
-    glm::vec3 wall_size;
-    btRigidBody *wall;
-
-    side = plane_edge * grid_height;
-    wall_size = glm::vec3(2*side, 5.0f, 0.0f);
-
-    wall_pos = glm::vec3(0.0f, 2.5f, -side);
-    wall = simulation.createRigidBody(BOX, wall_pos, wall_size, glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f, 0.0f, COLL_TERRAIN, COLL_EVERYTHING);
-    wall_pos = glm::vec3(0.0f, 2.5f, side);
-    wall = simulation.createRigidBody(BOX, wall_pos, wall_size, glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f, 0.0f, COLL_TERRAIN, COLL_EVERYTHING);
-
-    side = plane_edge * grid_width;
-    wall_size = glm::vec3(0.0f, 5.0f, 2*side);
-
-    wall_pos = glm::vec3(-side, 2.5f, 0.0f);
-    wall = simulation.createRigidBody(BOX, wall_pos, wall_size, glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f, 0.0f, COLL_TERRAIN, COLL_EVERYTHING);
-    wall_pos = glm::vec3(side, 2.5f, 0.0f);
-    wall = simulation.createRigidBody(BOX, wall_pos, wall_size, glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f, 0.0f, COLL_TERRAIN, COLL_EVERYTHING);
+    Track track(trackFile);
 
     // Muscle car
-    glm::vec3 spawn = glm::vec3(-40.0f, 0.0f, 0.0f);  // start position in world
+    glm::vec3 spawn = track.spawns[0];  // start position in world
+
+    // the terrain is a heightfield streamed from file (if provided), otherwise the tiled track
+    HeightfieldTerrain* heightfield = NULL;
+    Terrain* terrain = NULL;
+    if (heightfieldPath) {
+        heightfield = new HeightfieldTerrain(simulation, tModel0->meshes[0].textures);
+        if (!heightfield->Open(heightfieldPath)) {
+            delete heightfield;
+            heightfield = NULL;
+        }
+    }
+    if (heightfield) {
+        // the chunks around the spawn position must be in the world before the car is created
+        heightfield->Update(spawn, true);
+        spawn.y = heightfield->HeightAt(spawn.x, spawn.z);
+    } else {
+        // a single static body for all the tiles and the invisible walls (see Terrain class)
+        terrain = new Terrain(simulation, track);
+    }
 
-    glm::vec3 car_pos = glm::vec3(0.0f, 1.0f, 0.0f) + spawn;
-    glm::vec3 car_size = glm::vec3(1.0f, 0.6f, 3.0f);
-    glm::vec3 car_rot = glm::vec3(0.0f, 0.0f, 0.0f);
-    car = simulation.createRigidBody(BOX, car_pos, car_size, car_rot, car_mass, 1.75f, 0.2f, COLL_CHASSIS, COLL_EVERYTHING^COLL_CAR);
-    car->setSleepingThresholds(0.0, 0.0);   // never stop simulating
+    // the rigid bodies of the car (see Vehicle class)
+    Vehicle* vehicle = new Vehicle(simulation, spawn, car_mass, tyre_mass_1, tyre_mass_2, tyre_friction, tyre_stiffness, tyre_damping, lowLim, upLim);
+    player = vehicleStore.Add(vehicle);
+    // the car of the player never sleeps (see Vehicle class)
+    vehicle->SetControlled(true);
+    car = vehicle->chassis;
+    t1 = vehicle->wheels[WHEEL_FL];
+    t2 = vehicle->wheels[WHEEL_FR];
+    t3 = vehicle->wheels[WHEEL_RL];
+    t4 = vehicle->wheels[WHEEL_RR];
+    c1 = vehicle->suspensions[WHEEL_FL];
+    c2 = vehicle->suspensions[WHEEL_FR];
+    c3 = vehicle->suspensions[WHEEL_RL];
+    c4 = vehicle->suspensions[WHEEL_RR];
+
+    vehicle->drivetrain.peakTorque = maxAcceleration;
     car->setDamping(cLinDamp*assist, cAngDamp*assist);
+    for (unsigned int i = 0; i < WHEELS; i++)
+        vehicle->wheels[i]->setDamping(tLinDamp*assist, tAngDamp*assist);
 
-    btTransform frameA, frameB;
-
-    glm::vec3 t1_pos = glm::vec3(-1.0f, 0.5f, -2.1f) + spawn;
-    glm::vec3 t1_size = glm::vec3(0.4f, 0.35f, 0.35f);
-    glm::vec3 t1_rot = glm::vec3(0.0f, 0.0f, glm::radians(-90.0f));
-    t1 = simulation.createRigidBody(CYLINDER, t1_pos, t1_size, t1_rot, tyre_mass_1, tyre_friction, 0.0f, COLL_TYRE, COLL_EVERYTHING^COLL_CAR);
-    t1->setSleepingThresholds(0.0, 0.0);    // never stop simulating
-    t1->setDamping(tLinDamp*assist, tAngDamp*assist);
-    frameA = btTransform::getIdentity();
-    frameB = btTransform::getIdentity();
-    frameA.getBasis().setEulerZYX(0, 0, 0);
-    frameB.getBasis().setEulerZYX(0, 0, glm::radians(90.0f));
-    frameA.setOrigin(btVector3(-1.0, -0.5, -2.1));
-    frameB.setOrigin(btVector3(0.0, 0.0, 0.0));
-    c1 = new btGeneric6DofSpringConstraint(*car, *t1, frameA, frameB, TRUE);
-    c1->setLinearLowerLimit(btVector3(0, -lowLim, 0));
-    c1->setLinearUpperLimit(btVector3(0, -upLim, 0));
-    c1->setAngularLowerLimit(btVector3(1, -0.5, 0));
-    c1->setAngularUpperLimit(btVector3(-1, 0.5, 0));
-    c1->enableSpring(1, TRUE);
-    //c1->enableMotor(1, TRUE);
-    c1->setStiffness(1, tyre_stiffness);
-    c1->setDamping(1, tyre_damping);
-    c1->setEquilibriumPoint();
-
-    glm::vec3 t2_pos = glm::vec3(1.0f, 0.5f, -2.1f) + spawn;
-    glm::vec3 t2_size = glm::vec3(0.4f, 0.35f, 0.35f);
-    glm::vec3 t2_rot = glm::vec3(0.0f, 0.0f, glm::radians(90.0f));
-    t2 = simulation.createRigidBody(CYLINDER, t2_pos, t2_size, t2_rot, tyre_mass_1, tyre_friction, 0.0f, COLL_TYRE, COLL_EVERYTHING^COLL_CAR);
-    t2->setSleepingThresholds(0.0, 0.0);
-    t2->setDamping(tLinDamp*assist, tAngDamp*assist);
-    frameA = btTransform::getIdentity();
-    frameB = btTransform::getIdentity();
-    frameA.getBasis().setEulerZYX(0, 0, 0);
-    frameB.getBasis().setEulerZYX(0, 0, glm::radians(-90.0f));
-    frameA.setOrigin(btVector3(1.0, -0.5, -2.1));
-    frameB.setOrigin(btVector3(0.0, 0.0, 0.0));
-    c2 = new btGeneric6DofSpringConstraint(*car, *t2, frameA, frameB, TRUE);
-    c2->setLinearLowerLimit(btVector3(0, -lowLim, 0));
-    c2->setLinearUpperLimit(btVector3(0, -upLim, 0));
-    c2->setAngularLowerLimit(btVector3(1, -0.5, 0));
-    c2->setAngularUpperLimit(btVector3(-1, 0.5, 0));
-    c2->enableSpring(1, TRUE);
-    //c2->enableMotor(1, TRUE);
-    c2->setStiffness(1, tyre_stiffness);
-    c2->setDamping(1, tyre_damping);
-    c2->setEquilibriumPoint();
-
-    glm::vec3 t3_pos = glm::vec3(-1.0f, 0.5f, 1.6f) + spawn;
-    glm::vec3 t3_size = glm::vec3(0.45f, 0.4f, 0.4f);
-    glm::vec3 t3_rot = glm::vec3(0.0f, 0.0f, glm::radians(-90.0f));
-    t3 = simulation.createRigidBody(CYLINDER, t3_pos, t3_size, t3_rot, tyre_mass_2, tyre_friction, 0.0f, COLL_TYRE, COLL_EVERYTHING^COLL_CAR);
-    t3->setSleepingThresholds(0.0, 0.0);
-    t3->setDamping(tLinDamp*assist, tAngDamp*assist);
-    frameA = btTransform::getIdentity();
-    frameB = btTransform::getIdentity();
-    frameA.getBasis().setEulerZYX(0, 0, 0);
-    frameB.getBasis().setEulerZYX(0, 0, glm::radians(90.0f));
-    frameA.setOrigin(btVector3(-1.0, -0.5, 1.6));
-    frameB.setOrigin(btVector3(0.0, 0.0, 0.0));
-    c3 = new btGeneric6DofSpringConstraint(*car, *t3, frameA, frameB, TRUE);
-    c3->setLinearLowerLimit(btVector3(0, -lowLim, 0));
-    c3->setLinearUpperLimit(btVector3(0, -upLim, 0));
-    c3->setAngularLowerLimit(btVector3(1, 0, 0));
-    c3->setAngularUpperLimit(btVector3(-1, 0, 0));
-    c3->enableSpring(1, TRUE);
-    c3->setStiffness(1, tyre_stiffness);
-    c3->setDamping(1, tyre_damping);
-    c3->setEquilibriumPoint();
-
-    glm::vec3 t4_pos = glm::vec3(1.0f, 0.5f, 1.6f) + spawn;
-    glm::vec3 t4_size = glm::vec3(0.45f, 0.4f, 0.4f);
-    glm::vec3 t4_rot = glm::vec3(0.0f, 0.0f, glm::radians(90.0f));
-    t4 = simulation.createRigidBody(CYLINDER, t4_pos, t4_size, t4_rot, tyre_mass_2, tyre_friction, 0.0f, COLL_TYRE, COLL_EVERYTHING^COLL_CAR);
-    t4->setSleepingThresholds(0.0, 0.0);
-    t4->setDamping(tLinDamp*assist, tAngDamp*assist);
-    frameA = btTransform::getIdentity();
-    frameB = btTransform::getIdentity();
-    frameA.getBasis().setEulerZYX(0, 0, 0);
-    frameB.getBasis().setEulerZYX(0, 0, glm::radians(-90.0f));
-    frameA.setOrigin(btVector3(1.0, -0.5, 1.6));
-    frameB.setOrigin(btVector3(0.0, 0.0, 0.0));
-    c4 = new btGeneric6DofSpringConstraint(*car, *t4, frameA, frameB, TRUE);
-    c4->setLinearLowerLimit(btVector3(0, -lowLim, 0));
-    c4->setLinearUpperLimit(btVector3(0, -upLim, 0));
-    c4->setAngularLowerLimit(btVector3(1, 0, 0));
-    c4->setAngularUpperLimit(btVector3(-1, 0, 0));
-    c4->enableSpring(1, TRUE);
-    c4->setStiffness(1, tyre_stiffness);
-    c4->setDamping(1, tyre_damping);
-    c4->setEquilibriumPoint();
-
-    simulation.dynamicsWorld->addConstraint(c1);
-    simulation.dynamicsWorld->addConstraint(c2);
-    simulation.dynamicsWorld->addConstraint(c3);
-    simulation.dynamicsWorld->addConstraint(c4);
+    // the systems of the vehicles are updated at each physics tick, before the forces are integrated
+    simulation.dynamicsWorld->setInternalTickCallback(physicsTick, NULL, true);
 
     GLfloat maxSecPerFrame = 1.0f / 50.0f;
 
+    // tiles inside the view frustum (updated at each frame)
+    vector<GLuint> visibleTiles;
+
 
     // Game loop
     while (!glfwWindowShouldClose(window)) {
@@ -548,71 +489,50 @@ int main() {
 
         processInput(window);
 
-        btMatrix3x3 rot = car->getWorldTransform().getBasis();
-        short braking = 1;
-
-        // Acceleration
+        // Acceleration / braking: drive and brake torques are computed at each physics tick (see Drivetrain and Brakes classes)
         float linearVelocity = car->getLinearVelocity().length();
         gtk_level_bar_set_value(GTK_LEVEL_BAR(speedometer), linearVelocity);
         if (acceleration < 0 && linearVelocity > maxVelocity/10) {
-            braking = 0;
+            vehicleStore.throttle[player] = 0.0f;
+            vehicleStore.brake[player] = 1.0f;
         } else {
-            if (linearVelocity < maxVelocity/(1 + 9*(acceleration < 0))) {
-                float torque = -maxAcceleration * acceleration * (1-(abs(steering)*(linearVelocity>10))/2);
-                t1->applyTorque(rot * btVector3(torque, 0, 0));
-                t2->applyTorque(rot * btVector3(torque, 0, 0));
-                if (!handbrake) {
-                    t3->applyTorque(rot * btVector3(torque, 0, 0));
-                    t4->applyTorque(rot * btVector3(torque, 0, 0));
-                }
-            }
-        }
-
-        // Braking / steering
-        c1->setAngularLowerLimit(btVector3(braking, tyre_steering_angle*steering, 0));
-        c1->setAngularUpperLimit(btVector3(-braking, tyre_steering_angle*steering, 0));
-        c2->setAngularLowerLimit(btVector3(braking, tyre_steering_angle*steering, 0));
-        c2->setAngularUpperLimit(btVector3(-braking, tyre_steering_angle*steering, 0));
-
-        // Handbrake
-        if (handbrake) {
-            c3->setAngularLowerLimit(btVector3(0, 0, 0));
-            c3->setAngularUpperLimit(btVector3(0, 0, 0));
-            c4->setAngularLowerLimit(btVector3(0, 0, 0));
-            c4->setAngularUpperLimit(btVector3(0, 0, 0));
-        } else {
-            c3->setAngularLowerLimit(btVector3(braking, 0, 0));
-            c3->setAngularUpperLimit(btVector3(-braking, 0, 0));
-            c4->setAngularLowerLimit(btVector3(braking, 0, 0));
-            c4->setAngularUpperLimit(btVector3(-braking, 0, 0));
-        }
-
-
-        // Get up
-        if (getUp) {
-            car->applyTorqueImpulse(rot * btVector3(0, 0, 12000));
-        }
-
-        // Jump
-        if (jump) {
-            car->applyCentralImpulse(btVector3(0, 10000, 0));
+            vehicleStore.throttle[player] = acceleration;
+            vehicleStore.brake[player] = 0.0f;
         }
+        vehicleStore.handbrake[player] = handbrake;
+
+        // Steering, get up and jump: applied at the next physics ticks (see VehicleStore class)
+        vehicleStore.steer[player] = steering;
+        vehicleStore.steeringAngle[player] = tyre_steering_angle;
+        if (getUp)
+            vehicleStore.getUp[player] = 1;
+        if (jump)
+            vehicleStore.jump[player] = 1;
+        // back to the start position, at rest (the rig is moved in place, see Vehicle class)
+        if (respawn)
+            vehicleStore.Respawn(player, spawn);
 
         // Step physics forward
         simulation.dynamicsWorld->stepSimulation((deltaTime < maxSecPerFrame ? deltaTime : maxSecPerFrame), 10);
 
-        // Update camera position
+        // the heightfield chunks follow the car
+        if (heightfield) {
+            btVector3 carPos = car->getWorldTransform().getOrigin();
+            heightfield->Update(glm::vec3(carPos.x(), carPos.y(), carPos.z()));
+        }
+
+        // Update camera position (the render origin is computed in btScalar, see below)
+        btVector3 renderOrigin = toBullet(camera.Position);
         if (cameraFollow) {
             btTransform temp;
             btVector3 newPos;
 
             car->getMotionState()->getWorldTransform(temp);
             float aVelocity = -car->getAngularVelocity().y();
-            newPos = temp.getBasis() * btVector3(glm::cos(glm::radians(-10*glm::sqrt(glm::abs(steering))*aVelocity+90 + baseYaw/4))*cameraRadius, 0, glm::sin(glm::radians(-10*glm::sqrt(glm::abs(steering))*aVelocity + 90 + baseYaw/4))*cameraRadius);
+            newPos = temp.getBasis() * btVector3(glm::cos(glm::radians(-10*glm::sqrt(glm::abs(vehicle->steering))*aVelocity+90 + baseYaw/4))*cameraRadius, 0, glm::sin(glm::radians(-10*glm::sqrt(glm::abs(vehicle->steering))*aVelocity + 90 + baseYaw/4))*cameraRadius);
 
-            cameraFollowPos.x = temp.getOrigin().getX() + newPos.x();
-            cameraFollowPos.y = temp.getOrigin().getY() - glm::sin(glm::radians(camera.Pitch))*cameraRadius +1.5;
-            cameraFollowPos.z = temp.getOrigin().getZ() + newPos.z();
+            renderOrigin = temp.getOrigin() + btVector3(newPos.x(), -glm::sin(glm::radians(camera.Pitch))*cameraRadius + 1.5, newPos.z());
+            cameraFollowPos = toGlm(renderOrigin);
 
             //camera.Yaw = glm::degrees(temp.getBasis().getColumn(2).length())
             camera.Position = cameraFollowPos;// - glm::vec3(glm::cos(glm::radians(Y))*8, glm::sin(glm::radians(P))*8-1.5, glm::sin(glm::radians(Y))*8);
@@ -622,13 +542,23 @@ int main() {
 
         // Transforms
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 10000.0f);
-        glm::mat4 view = camera.GetViewMatrix();
+        // camera-relative rendering: the view has only the rotation of the camera, and the model matrices are relative to the camera position
+        // (the physics can be in double precision, see Physics.hpp: the big world coordinates are never sent to the GPU)
+        // the origin is snapped to float precision once, so the bodies (btScalar, see renderMatrix) and the terrain, lights and frustum (float) subtract the same value
+        renderOrigin = toBullet(toGlm(renderOrigin));
+        glm::vec3 origin = toGlm(renderOrigin);
+        glm::mat4 view = glm::mat4(glm::mat3(camera.GetViewMatrix()));
+        glm::mat4 worldView = view * glm::translate(glm::mat4(1.0f), -origin);
+
+        // objects outside the view frustum are not sent to the GPU (the frustum is in world coordinates)
+        frustum.Update(projection, worldView);
+        frustum.ResetCounters();
 
         // Terrain
         tShader.Use();
         tShader.setMat4("projection", projection);
         tShader.setMat4("view", view);
-        tShader.setVec3("viewPos", camera.Position);
+        tShader.setVec3("viewPos", glm::vec3(0.0f));
 
         tShader.setVec3("light.direction", 1.0f, -0.5f, -0.5f);
         tShader.setVec3("light.ambient", 0.473f, 0.428f, 0.322f);
@@ -636,27 +566,39 @@ int main() {
         glm::mat4 model = glm::mat4(1.0f);
         //model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); // translate it down so it's at the center of the scene
 
-        glm::mat4 planeModelMatrix = glm::mat4(1.0f);
-        for (unsigned int i = 0; i < grid_width; i++) {
-            for (unsigned int j = 0; j < grid_height; j++) {
-                planeModelMatrix = glm::translate(planeModelMatrix, plane_pos[i*(grid_height)+j]);
-                glUniformMatrix4fv(glGetUniformLocation(tShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
-
-        if (track[j][i] == 0) {
-            // Grass
+        if (heightfield) {
+            // only the loaded chunks inside the view frustum are rendered (see HeightfieldTerrain class)
             tShader.setFloat("material.shininess", 4.0f);
             tShader.setVec3("light.diffuse", 1.195f, 1.105f, 0.893f);
             tShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-            tModel0.Draw(tShader);
-        } else if (track[j][i] == 1) {
-            // Asphalt
-            tShader.setFloat("material.shininess", 16.0f);
-            tShader.setVec3("light.diffuse", 0.945f, 0.855f, 0.643f);
-            tShader.setVec3("light.specular", 2.75f, 2.75f, 2.75f);
-            tModel1.Draw(tShader);
-        }
-
-                planeModelMatrix = glm::mat4(1.0f);
+            heightfield->Draw(tShader, frustum, origin);
+        } else {
+            // only the tiles inside the view frustum are rendered (see Track class)
+            track.VisibleTiles(frustum, visibleTiles);
+
+            glm::mat4 planeModelMatrix = glm::mat4(1.0f);
+            for (unsigned int type = TILE_GRASS; type <= TILE_ASPHALT; type++) {
+                if (type == TILE_GRASS) {
+                    // Grass
+                    tShader.setFloat("material.shininess", 4.0f);
+                    tShader.setVec3("light.diffuse", 1.195f, 1.105f, 0.893f);
+                    tShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
+                } else {
+                    // Asphalt
+                    tShader.setFloat("material.shininess", 16.0f);
+                    tShader.setVec3("light.diffuse", 0.945f, 0.855f, 0.643f);
+                    tShader.setVec3("light.specular", 2.75f, 2.75f, 2.75f);
+                }
+                Model* tileModel = (type == TILE_GRASS) ? tModel0 : tModel1;
+
+                for (unsigned int i = 0; i < visibleTiles.size(); i++) {
+                    // paved tiles (dry or wet asphalt) use the asphalt model, the others the grass model
+                    if (track.Paved(visibleTiles[i]) != (type == TILE_ASPHALT))
+                        continue;
+                    planeModelMatrix = glm::translate(glm::mat4(1.0f), track.Position(visibleTiles[i]) - origin);
+                    glUniformMatrix4fv(glGetUniformLocation(tShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
+                    tileModel->Draw(tShader);
+                }
             }
         }
 
@@ -671,36 +613,27 @@ int main() {
         glm::mat4 objModelMatrix;
         glm::mat3 objNormalMatrix;
 
-        GLfloat matrix[16];
         btTransform transform;
 
         glm::vec3 obj_size(1.0f);
         Model* objectModel;
 
-        int num_cobjs = simulation.dynamicsWorld->getNumCollisionObjects();
+        // the bodies of the car, with the corresponding models
+        btRigidBody* carBodies[5] = { car, t1, t2, t3, t4 };
+        Model* carModels[5] = { mModel, t1Model, t1Model, t2Model, t2Model };
 
-        for (unsigned int i=tiles+walls; i<num_cobjs;i++)
+        for (unsigned int i=0; i<5;i++)
         {
-            switch (i) {
-                case tiles+walls: objectModel = &mModel; break;
-                case tiles+walls+1: case tiles+walls+2: objectModel = &t1Model; break;
-                case tiles+walls+3: case tiles+walls+4: objectModel = &t2Model; break;
-                default: return(EXIT_FAILURE);
-            }
-            // we take the Collision Object from the list
-            btCollisionObject* obj = simulation.dynamicsWorld->getCollisionObjectArray()[i];
-
-            // we upcast it in order to use the methods of the main class RigidBody
-            btRigidBody* body = btRigidBody::upcast(obj);
+            objectModel = carModels[i];
+            btRigidBody* body = carBodies[i];
 
             // we take the transformation matrix of the rigid boby, as calculated by the physics engine
             body->getMotionState()->getWorldTransform(transform);
 
-            // we convert the Bullet matrix (transform) to an array of floats
-            transform.getOpenGLMatrix(matrix);
-
-            // we create the GLM transformation matrix
-            objModelMatrix = glm::make_mat4(matrix) * glm::scale(objModelMatrix, obj_size);
+            // we create the GLM transformation matrix, relative to the camera (the Bullet matrix can be in double precision)
+            objModelMatrix = renderMatrix(transform, renderOrigin) * glm::scale(glm::mat4(1.0f), obj_size);
+            if (!frustum.IsVisible(glm::translate(glm::mat4(1.0f), origin) * objModelMatrix, objectModel->boundsMin, objectModel->boundsMax))
+                continue;
             objNormalMatrix = glm::transpose(glm::inverse(glm::mat3(objModelMatrix)));
 
             // we create the normal matrix
@@ -708,8 +641,8 @@ int main() {
             glUniformMatrix3fv(glGetUniformLocation(mShader.Program, "normal"), 1, GL_FALSE, glm::value_ptr(objNormalMatrix));
 
             mShader.setVec3("lightColor", glm::vec3(1.0));
-            mShader.setVec3("lightPos", lightPos);
-            mShader.setVec3("viewPos", camera.Position);
+            mShader.setVec3("lightPos", lightPos - origin);
+            mShader.setVec3("viewPos", glm::vec3(0.0f));
 
             mShader.setFloat("material.shininess", 128.0f);
 
@@ -734,22 +667,46 @@ int main() {
 
         //mModel.Draw(mShader);
 
-        view = glm::mat4(glm::mat3(camera.GetViewMatrix()));
-
-        // Skybox
+        // Skybox (the view is already without translation)
         glDepthFunc(GL_LEQUAL);
         sShader.Use();
         sShader.setMat4("projection", projection);
         sShader.setMat4("view", view);
-        glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        skyboxMesh.Draw(sShader);
         glDepthFunc(GL_LESS);
 
+        // frame rate and culling statistics (updated once per second)
+        frames++;
+        if (currentFrame - lastStats >= 1.0f) {
+            std::string gear = (vehicle->drivetrain.gear == 0) ? "R" : std::to_string(vehicle->drivetrain.gear);
+            std::string title = std::string(APP_NAME) + " - " + std::to_string(frames) + " fps - culled " + std::to_string(frustum.culled) + "/" + std::to_string(frustum.tested)
+                + " - gear " + gear + " " + std::to_string((int)vehicle->drivetrain.rpm) + " rpm";
+            glfwSetWindowTitle(window, title.c_str());
+            frames = 0;
+            lastStats = currentFrame;
+        }
+
         glfwPollEvents();
         glfwSwapBuffers(window);
     }
+    skyboxMesh.Delete();
+    // the chunks are removed from the world and from the shared buffers
+    // the owners of the bodies are deleted first, then the simulation
+    delete heightfield;
+    delete terrain;
+    for (unsigned int i = 0; i < vehicleStore.vehicles.size(); i++)
+        delete vehicleStore.vehicles[i];
+    vehicleStore.vehicles.clear();
+    simulation.Clear();
+    // the models release their ranges of the shared buffers, before the buffers are deleted
+    delete mModel;
+    delete t1Model;
+    delete t2Model;
+    delete tModel0;
+    delete tModel1;
+    GeometryArena::Static().Delete();
     glfwTerminate();
     return EXIT_SUCCESS;
 }
@@ -788,20 +745,13 @@ void processInput(GLFWwindow* window) {
         //if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS))
     }
 
-    float steering_limit = 1.0f;
-    float steering_speed = 0.05f;
-
-    // Car controls - steering
+    // Car controls - steering (the steering moves towards the requested position at each physics tick)
     if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-        if (steering > -steering_limit)
-            steering -= steering_speed;
+        steering = -1.0f;
     } else if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-        if (steering < steering_limit)
-            steering += steering_speed;
+        steering = 1.0f;
     } else {
-        steering -= steering_speed * ((steering > 0) - (steering < 0));
-        if (steering < steering_speed && steering > -steering_speed)
-            steering = 0.0f;
+        steering = 0.0f;
     }
 
     // Car controls - acceleration
@@ -842,6 +792,26 @@ void processInput(GLFWwindow* window) {
     if (glfwGetKey(window, GLFW_KEY_T) == GLFW_RELEASE) {
         jumped = FALSE;
     }
+
+    // Car controls - respawn at the start position
+    if (glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_PRESS && !respawned) {
+        respawn = TRUE;
+        respawned = TRUE;
+    } else {
+        respawn = FALSE;
+    }
+    if (glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_RELEASE) {
+        respawned = FALSE;
+    }
+}
+
+// Physics tick: called by Bullet before each internal step of the simulation (also several times for each frame)
+void physicsTick(btDynamicsWorld* world, btScalar timeStep) {
+    // Control inputs, engine, transmission and brakes (with ABS and traction control), drag and downforce of all the vehicles
+    vehicleStore.Update(timeStep);
+
+    // Tyre forces
+    tyreModel.Update(vehicleStore.vehicles, world, timeStep);
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
@@ -950,10 +920,8 @@ void damping_callback(GtkWidget *widget, gpointer callback_data) {
 
 void friction_callback(GtkWidget *widget, gpointer callback_data) {
     tyre_friction = gtk_range_get_value(GTK_RANGE(widget));
-    t1->setFriction(tyre_friction);
-    t2->setFriction(tyre_friction);
-    t3->setFriction(tyre_friction);
-    t4->setFriction(tyre_friction);
+    for (unsigned int i = 0; i < vehicleStore.vehicles.size(); i++)
+        vehicleStore.vehicles[i]->SetTyreFriction(tyre_friction);
     cout << "Friction: " << tyre_friction << endl;
 }
 
@@ -964,6 +932,9 @@ void steering_callback(GtkWidget *widget, gpointer callback_data) {
 
 void acceleration_callback(GtkWidget *widget, gpointer callback_data) {
     maxAcceleration = gtk_range_get_value(GTK_RANGE(widget));
+    // peak torque of the engine
+    for (unsigned int i = 0; i < vehicleStore.vehicles.size(); i++)
+        vehicleStore.vehicles[i]->drivetrain.peakTorque = maxAcceleration;
     cout << "Acceleration: " << maxAcceleration << endl;
 }
 
@@ -1016,3 +987,24 @@ void preset3_callback(GtkWidget *widget, gpointer callback_data) {
     gtk_range_set_value(GTK_RANGE(accelerate), 680);
     cout << "Preset: Sport" << endl;
 }
+
+void tyremodel_callback(GtkWidget *widget, gpointer callback_data) {
+    bool enabled = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widget));
+    for (unsigned int i = 0; i < vehicleStore.vehicles.size(); i++)
+        vehicleStore.vehicles[i]->EnableTyreModel(enabled);
+    cout << "Tyre model: " << (enabled ? "Magic Formula" : "Bullet friction") << endl;
+}
+
+void abs_callback(GtkWidget *widget, gpointer callback_data) {
+    bool enabled = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widget));
+    for (unsigned int i = 0; i < vehicleStore.vehicles.size(); i++)
+        vehicleStore.vehicles[i]->brakes.abs = enabled;
+    cout << "ABS: " << (enabled ? "on" : "off") << endl;
+}
+
+void tc_callback(GtkWidget *widget, gpointer callback_data) {
+    bool enabled = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widget));
+    for (unsigned int i = 0; i < vehicleStore.vehicles.size(); i++)
+        vehicleStore.vehicles[i]->brakes.tc = enabled;
+    cout << "Traction control: " << (enabled ? "on" : "off") << endl;
+}
@@ -0,0 +1,88 @@
+/*
+    g++ tests/drivetrain.cpp -o drivetrain_test -I ./includes
+
+Drivetrain tests: the Drivetrain class does not depend on Bullet or OpenGL, so it is tested alone, on the CPU.
+
+- the drive torques of the four wheels sum to the engine torque at the wheels (engine torque x gear ratio x final drive), with and without the handbrake
+- with the handbrake pulled, the rear wheels get no torque
+- with the handbrake pulled, the engine speed follows the front wheels only (the locked rear wheels must not pull it down, or the gearbox downshifts)
+
+The test prints each check, and it returns a non-zero exit code if one of them fails.
+*/
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <utils/Drivetrain.hpp>
+
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+int failures = 0;
+
+//////////////////////////////////////////
+// we compare two values, with a relative tolerance
+void check(const char* name, GLfloat value, GLfloat expected)
+{
+    bool passed = glm::abs(value - expected) <= 1e-4f * glm::max(1.0f, glm::abs(expected));
+    cout << (passed ? "PASS " : "FAIL ") << name << ": " << value << " (expected " << expected << ")" << endl;
+    if (!passed)
+        failures++;
+}
+
+//////////////////////////////////////////
+// one step in first gear, full throttle, with the clutch engaged (engine speed between launch and upshift): we check the torques of the wheels
+void testTorqueSplit(bool handbrake, int rearDiff, GLfloat spinDifference)
+{
+    const GLfloat toRpm = 60.0f / (2.0f * glm::pi<GLfloat>());
+    Drivetrain drivetrain;
+    drivetrain.rearDiff = rearDiff;
+    GLfloat ratio = drivetrain.gearRatios[1] * drivetrain.finalDrive;
+    // average spin of the wheels for 3500 rpm in first gear
+    GLfloat spin = 3500.0f / (ratio * toRpm);
+    GLfloat wheelSpin[WHEELS] = { spin, spin, spin - spinDifference, spin + spinDifference };
+    GLfloat torque[WHEELS];
+    drivetrain.Step(wheelSpin, 1.0f, handbrake, 1.0f / 60.0f, torque);
+
+    GLfloat engineTorque = drivetrain.CurveAt(drivetrain.rpm) * drivetrain.peakTorque;
+    GLfloat sum = torque[WHEEL_FL] + torque[WHEEL_FR] + torque[WHEEL_RL] + torque[WHEEL_RR];
+    cout << "handbrake " << (handbrake ? "on" : "off") << ", rear " << (rearDiff == DIFF_OPEN ? "open" : "limited slip") << " differential" << endl;
+    check("  sum of the wheel torques", sum, engineTorque * ratio);
+    check("  front axle", torque[WHEEL_FL] + torque[WHEEL_FR], engineTorque * ratio * (handbrake ? 1.0f : drivetrain.frontSplit));
+    check("  rear axle", torque[WHEEL_RL] + torque[WHEEL_RR], engineTorque * ratio * (handbrake ? 0.0f : 1.0f - drivetrain.frontSplit));
+}
+
+//////////////////////////////////////////
+// one step in second gear, full throttle, with the rear wheels locked by the handbrake: engine speed and gear come from the front wheels
+void testHandbrakeSpin()
+{
+    const GLfloat toRpm = 60.0f / (2.0f * glm::pi<GLfloat>());
+    Drivetrain drivetrain;
+    drivetrain.gear = 2;
+    GLfloat ratio = drivetrain.gearRatios[2] * drivetrain.finalDrive;
+    // spin of the front wheels for 3500 rpm in second gear (above launch and downshift speeds)
+    GLfloat spin = 3500.0f / (ratio * toRpm);
+    GLfloat wheelSpin[WHEELS] = { spin, spin, 0.0f, 0.0f };
+    GLfloat torque[WHEELS];
+    drivetrain.Step(wheelSpin, 1.0f, true, 1.0f / 60.0f, torque);
+
+    cout << "handbrake on, rear wheels locked" << endl;
+    check("  engine speed", drivetrain.rpm, 3500.0f);
+    check("  gear", (GLfloat)drivetrain.gear, 2.0f);
+    check("  clutch engaged (no shift)", drivetrain.shiftTimer, 0.0f);
+}
+
+int main()
+{
+    testTorqueSplit(false, DIFF_OPEN, 0.0f);
+    testTorqueSplit(true, DIFF_OPEN, 0.0f);
+    // the limited slip differential moves torque between the rear wheels, but it does not change the total
+    testTorqueSplit(false, DIFF_LIMITED_SLIP, 2.0f);
+    testTorqueSplit(true, DIFF_LIMITED_SLIP, 2.0f);
+    testHandbrakeSpin();
+
+    cout << (failures ? "FAILED" : "OK") << endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/*
+    g++ tests/regions.cpp -o regions_test -O1 -g -fsanitize=thread -pthread -DBT_NO_PROFILE -DREGIONS_PARALLEL -I ./includes -I ./includes/bullet/ ./includes/bullet/BulletDynamics/libBulletDynamics.a ./includes/bullet/BulletCollision/libBulletCollision.a ./includes/bullet/LinearMath/libLinearMath.a
+    TSAN_OPTIONS="suppressions=tests/tsan-bullet.supp halt_on_error=1" ./regions_test
+
+Parallel regions test (see RegionExecutor class): the same scenes are stepped by an executor without workers (all the regions on the calling thread) and by executors with several workers, and the results must be identical.
+
+- each region has a flat ground and a grid of vehicles driving in circles, with different inputs in each region (so the regions have different costs, and the workers steal tasks)
+- after each step, the merged statistics (ticks, awake vehicles) are compared
+- at the end, the transforms of all the chassis and wheels are compared exactly
+
+Under ThreadSanitizer (Bullet compiled with -fsanitize=thread too), the test checks that the parallel step has no data races: the only ones known are the statistics counters of Bullet, which are suppressed (see tests/tsan-bullet.supp, and N.B. 2 in Regions.hpp).
+The test prints each check, and it returns a non-zero exit code if one of them fails.
+
+N.B.) Bullet and the test must be compiled with -DBT_NO_PROFILE, and the test with -DREGIONS_PARALLEL (otherwise the executors have no workers, see N.B. 4 in Regions.hpp)
+*/
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <utils/Regions.hpp>
+
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+// parameters of the rig of the application (see main() in src/App.cpp)
+const float car_mass = 1250.0f;
+const float tyre_mass_1 = 15.0f;
+const float tyre_mass_2 = 20.0f;
+const float tyre_friction = 2.25f;
+const float tyre_stiffness = 120000.0f;
+const float tyre_damping = 0.0000200f;
+const float lowLim = 0.0f;
+const float upLim = 0.1f;
+
+const int REGIONS = 12;
+const int STEPS = 300;
+const float spacing = 8.0f;
+
+int failures = 0;
+
+void check(const string& name, bool passed)
+{
+    cout << (passed ? "PASS " : "FAIL ") << name << endl;
+    if (!passed)
+        failures++;
+}
+
+//////////////////////////////////////////
+// the regions of the test: region r has r % 4 + 1 rows of 4 vehicles, with throttle and steering depending on the region
+void buildRegions(RegionExecutor& executor)
+{
+    for (int r = 0; r < REGIONS; r++) {
+        Region* region = executor.AddRegion();
+        region->simulation.createRigidBody(BOX, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(200.0f, 1.0f, 200.0f), glm::vec3(0.0f), 0.0f, 1.0f, 0.0f, COLL_TERRAIN, COLL_EVERYTHING);
+        int count = 4 * (r % 4 + 1);
+        for (int i = 0; i < count; i++) {
+            glm::vec3 spawn = glm::vec3((i % 4 - 2) * spacing, 0.0f, (i / 4 - 2) * spacing);
+            Vehicle* vehicle = region->AddVehicle(spawn, car_mass, tyre_mass_1, tyre_mass_2, tyre_friction, tyre_stiffness, tyre_damping, lowLim, upLim);
+            vehicle->SetControlled(true);
+            vehicle->throttle = 0.3f + 0.05f * (r % 5);
+            vehicle->steer = (i % 2 == 0) ? 0.5f : -0.5f;
+        }
+    }
+}
+
+// transforms of all the bodies of the vehicles of all the regions (chassis and wheels, in order)
+vector<btTransform> snapshot(RegionExecutor& executor)
+{
+    vector<btTransform> transforms;
+    for (unsigned int r = 0; r < executor.regions.size(); r++) {
+        vector<Vehicle*>& vehicles = executor.regions[r]->vehicles;
+        for (unsigned int i = 0; i < vehicles.size(); i++) {
+            transforms.push_back(vehicles[i]->chassis->getWorldTransform());
+            for (int w = 0; w < WHEELS; w++)
+                transforms.push_back(vehicles[i]->wheels[w]->getWorldTransform());
+        }
+    }
+    return transforms;
+}
+
+//////////////////////////////////////////
+// we step the same scenes on the calling thread and with the given number of workers, and we compare the results
+void testWorkers(int workers)
+{
+    RegionExecutor serial(0);
+    RegionExecutor parallel(workers);
+    buildRegions(serial);
+    buildRegions(parallel);
+
+    bool sameStats = true;
+    for (int i = 0; i < STEPS; i++) {
+        serial.Step(1.0f / 60.0f);
+        parallel.Step(1.0f / 60.0f);
+        sameStats = sameStats && serial.ticks == parallel.ticks && serial.awake == parallel.awake;
+    }
+
+    vector<btTransform> expected = snapshot(serial);
+    vector<btTransform> result = snapshot(parallel);
+    bool sameTransforms = expected.size() == result.size();
+    // exact comparison: the regions do not share data, so the order of the threads must not change a single bit
+    for (unsigned int i = 0; sameTransforms && i < expected.size(); i++)
+        sameTransforms = (expected[i] == result[i]);
+
+    cout << parallel.Threads() << " threads, " << REGIONS << " regions, " << STEPS << " steps" << endl;
+    check("  same statistics at each step", sameStats);
+    check("  same transforms of the vehicles", sameTransforms);
+}
+
+int main()
+{
+    testWorkers(1);
+    testWorkers(3);
+    testWorkers(7);
+
+    cout << (failures ? "FAILED" : "OK") << endl;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+/*
+    g++ tools/trackc.cpp -o trackc -I ./includes
+
+Track converter: it reads a track in text format, and it writes the corresponding binary file, which is loaded by the application without parsing (see TrackFile class).
+
+    ./trackc tracks/oval.txt tracks/oval.trk
+*/
+
+#include <utils/TrackFile.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cout << "Usage: " << argv[0] << " <input.txt> <output.trk>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream input(argv[1]);
+    if (!input) {
+        std::cout << "ERROR: cannot open " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::stringstream text;
+    text << input.rdbuf();
+    std::string source = text.str();
+
+    std::vector<unsigned char> binary;
+    std::string error;
+    if (!TrackFile::Compile(source.c_str(), source.size(), binary, error)) {
+        std::cout << "ERROR: " << argv[1] << ": " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream output(argv[2], std::ios::binary);
+    output.write((const char*)&binary[0], binary.size());
+    if (!output) {
+        std::cout << "ERROR: cannot write " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+    const TrackFileHeader* header = (const TrackFileHeader*)&binary[0];
+    std::cout << argv[2] << ": " << header->width << "x" << header->height << " tiles, " << header->materialCount << " materials, " << header->wallCount << " walls, " << header->spawnCount << " spawn points" << std::endl;
+    return EXIT_SUCCESS;
+}